@@ -35,3 +35,55 @@ class SRCNN(nn.Module):
 		residual = x
 		out = self.network(x)
 		return out + residual
+
+
+class SubPixelSRCNN(nn.Module):
+	"""
+	ESPCN-style post-upsampling network. Every convolution runs on the low resolution
+	input, and the last layer's scale^2 channels are rearranged into the high resolution
+	image by a pixel shuffle, so no bicubic pre-upscale is needed.
+	"""
+	def __init__(self, scale=2, num_layers=4, num_features=64):
+		super(SubPixelSRCNN, self).__init__()
+		self.scale = scale
+
+		layers = []
+
+		# First layer: 1 -> num_features, wider kernel for more LR context
+		layers.append(nn.Conv2d(1, num_features, kernel_size=5, padding=2))
+		layers.append(nn.ReLU(inplace=False))
+
+		# Hidden layers: num_features -> num_features
+		for _ in range(num_layers - 2):
+			layers.append(nn.Conv2d(num_features, num_features, kernel_size=3, padding=1))
+			layers.append(nn.ReLU(inplace=False))
+
+		# Final layer: num_features -> scale^2 sub-pixel planes
+		layers.append(nn.Conv2d(num_features, scale * scale, kernel_size=3, padding=1))
+
+		self.network = nn.Sequential(*layers)
+		self.upsample = nn.PixelShuffle(scale)
+
+		self._initialize_weights()
+
+	def _initialize_weights(self):
+		for m in self.modules():
+			if isinstance(m, nn.Conv2d):
+				nn.init.kaiming_normal_(m.weight, nonlinearity='relu')
+				if m.bias is not None:
+					nn.init.zeros_(m.bias)
+
+	def forward(self, x):
+		return self.upsample(self.network(x))
+
+
+def create_model(arch="srcnn", scale=2):
+	"""
+	"srcnn"  - pre-upsampling model, input is the bicubic upscaled image
+	"espcn"  - sub-pixel model, input is the low resolution image
+	"""
+	if arch == "srcnn":
+		return SRCNN()
+	if arch == "espcn":
+		return SubPixelSRCNN(scale=scale)
+	raise ValueError(f"Unknown architecture: {arch}")
@@ -6,10 +6,12 @@ import torch
 from torch.utils.data import Dataset
 
 class SRDataset(Dataset):
-	def __init__(self, image_dir, patch_size=33, scale=2, stride=14):
+	def __init__(self, image_dir, patch_size=33, scale=2, stride=14, pre_upsample=True):
 		super().__init__();
 		self.scale = scale
 		self.patch_size = patch_size
+		# False yields LR patches at LR size for sub-pixel models
+		self.pre_upsample = pre_upsample
 		self.patches_lr = []
 		self.patches_hr = []
 
@@ -56,6 +58,9 @@ class SRDataset(Dataset):
 		hr = img.astype(np.float32) / 255.0
 
 		lr = cv2.resize(hr, (w // self.scale, h // self.scale), interpolation=cv2.INTER_CUBIC)
+		if not self.pre_upsample:
+			self._extract_subpixel_patches(hr, lr, stride)
+			return
 		lr = cv2.resize(lr, (w, h), interpolation=cv2.INTER_CUBIC)
 
 		# extract patches
@@ -68,6 +73,25 @@ class SRDataset(Dataset):
 				self.patches_hr.append(torch.from_numpy(hr_patch).unsqueeze(0))
 				self.patches_lr.append(torch.from_numpy(lr_patch).unsqueeze(0))
 	
+	def _extract_subpixel_patches(self, hr, lr, stride):
+		"""
+		HR patches are patch_size rounded down to a multiple of scale,
+		LR patches are the matching patch_size // scale region of the LR image.
+		"""
+		lr_size = self.patch_size // self.scale
+		hr_size = lr_size * self.scale
+		lr_stride = max(1, stride // self.scale)
+		lr_h, lr_w = lr.shape
+
+		for y in range(0, lr_h - lr_size + 1, lr_stride):
+			for x in range(0, lr_w - lr_size + 1, lr_stride):
+				hy, hx = y * self.scale, x * self.scale
+				hr_patch = hr[hy:hy + hr_size, hx:hx + hr_size]
+				lr_patch = lr[y:y + lr_size, x:x + lr_size]
+
+				self.patches_hr.append(torch.from_numpy(hr_patch).unsqueeze(0))
+				self.patches_lr.append(torch.from_numpy(lr_patch).unsqueeze(0))
+
 	def __len__(self):
 		return len(self.patches_lr)
 
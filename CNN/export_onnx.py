@@ -2,7 +2,7 @@ import torch
 import os
 import glob
 import re
-from SRCNN import SRCNN
+from SRCNN import create_model
 import onnx
 import onnxruntime as ort
 import numpy as np
@@ -27,25 +27,28 @@ def verify(onnx_path="models/onnx/srcnn_v1.onnx"):
     print(f"  Output shape: {output[0].shape}")
     print("  Inference OK")
 
-def get_next_vestion(onnx_dir):
-	existing = glob.glob(os.path.join(onnx_dir, "srcnn_v*.onnx"))
+def get_next_vestion(onnx_dir, prefix="srcnn"):
+	existing = glob.glob(os.path.join(onnx_dir, f"{prefix}_v*.onnx"))
 	versions = []
 	for path in existing:
-		match = re.search(r"srcnn_v(\d+)\.onnx", os.path.basename(path))
+		match = re.search(rf"{re.escape(prefix)}_v(\d+)\.onnx", os.path.basename(path))
 		if match:
 			versions.append(int(match.group(1)))
 	return max(versions, default=0) + 1
 
-def export_onnx(weights_path="models/pth/best_srcnn.pth", outpur_dir="models/onnx", patch_size=33):
+def export_onnx(weights_path="models/pth/best_srcnn.pth", outpur_dir="models/onnx", patch_size=33, arch="srcnn", scale=2):
 	os.makedirs(outpur_dir, exist_ok=True)
 	
-	model = SRCNN()
+	model = create_model(arch, scale)
 	print(weights_path)
 	model.load_state_dict(torch.load(weights_path, map_location="cpu", weights_only=True))
 	model.eval()
 
-	version = get_next_vestion(outpur_dir)
-	onnx_path = os.path.join(outpur_dir, f"srcnn_v{version}.onnx")
+	# Sub-pixel models are named per scale; the C++ side reads the scale from the output shape
+	prefix = "srcnn" if arch == "srcnn" else f"{arch}_x{scale}"
+	version = get_next_vestion(outpur_dir, prefix)
+	onnx_path = os.path.join(outpur_dir, f"{prefix}_v{version}.onnx")
+	out_axes = {2: "height", 3: "width"} if arch == "srcnn" else {2: "out_height", 3: "out_width"}
 
 	dummy_input = torch.randn(1, 1, patch_size, patch_size)
 
@@ -60,7 +63,7 @@ def export_onnx(weights_path="models/pth/best_srcnn.pth", outpur_dir="models/onn
 		output_names=["output"],
 		dynamic_axes={
             "input":  {2: "height", 3: "width"},
-            "output": {2: "height", 3: "width"},
+            "output": out_axes,
         },
 	)
 
@@ -68,5 +71,5 @@ def export_onnx(weights_path="models/pth/best_srcnn.pth", outpur_dir="models/onn
 	return onnx_path, version
 
 if __name__ == "__main__":
-	export_onnx()
-	verify()
+	onnx_path, _ = export_onnx()
+	verify(onnx_path)
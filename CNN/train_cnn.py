@@ -1,17 +1,18 @@
 from SRDataset import SRDataset
-from SRCNN import SRCNN
+from SRCNN import create_model
 import torch
 import torch.nn as nn
 from torch.utils.data import DataLoader, random_split, ConcatDataset
 from torchvision import transforms
+import argparse
 import os
 import time
 from export_onnx import export_onnx
 
-def train(data_dir, train_minutes = 240, batch_size=64, lr=1e-3, val_split=0.2, scale=2):
+def train(data_dir, train_minutes = 240, batch_size=64, lr=1e-3, val_split=0.2, scale=2, arch="srcnn"):
 	device = torch.device("cuda" if torch.cuda.is_available() else "cpu")
 	print("\nLoading dataset...", flush=True)
-	dataset = SRDataset(data_dir, patch_size=33, scale=scale, stride=14)
+	dataset = SRDataset(data_dir, patch_size=33, scale=scale, stride=14, pre_upsample=(arch == "srcnn"))
 	val_size = int(len(dataset) * val_split)
 	train_size = len(dataset) - val_size
 	train_dataset, val_dataset = random_split(dataset, [train_size, val_size])
@@ -20,7 +21,8 @@ def train(data_dir, train_minutes = 240, batch_size=64, lr=1e-3, val_split=0.2,
 	val_loader = DataLoader(val_dataset, batch_size=batch_size, shuffle=False)
 
 	
-	model = SRCNN().to(device)
+	model = create_model(arch, scale).to(device)
+	weights_path = "models/pth/best_srcnn.pth" if arch == "srcnn" else f"models/pth/best_{arch}_x{scale}.pth"
 	criterion = nn.MSELoss()
 	optimizer = torch.optim.Adam(model.parameters(), lr=lr)
 
@@ -34,6 +36,7 @@ def train(data_dir, train_minutes = 240, batch_size=64, lr=1e-3, val_split=0.2,
 	time_limit = train_minutes * 60
 
 	print(f"\n  Device:         {device}")
+	print(f"    Architecture:   {arch}")
 	print(f"    Scale factor:   {scale}x")
 	print(f"    Batch size:     {batch_size}")
 	print(f"    Train patches:  {train_size}")
@@ -101,13 +104,19 @@ def train(data_dir, train_minutes = 240, batch_size=64, lr=1e-3, val_split=0.2,
 
 		if val_loss < best_val_loss:
 			best_val_loss = val_loss
-			torch.save(model.state_dict(), "models/pth/best_srcnn.pth")
+			torch.save(model.state_dict(), weights_path)
 			print(f"  -> saved best model (val_loss={best_val_loss:.6f})")
 	total = time.time() - start_time
 	print(f"Training complete. {epoch} epochs in {total:.1f}s. Best val_loss: {best_val_loss:.6f}")
 
-	onnx_path, version = export_onnx("models/pth/best_srcnn.pth", "models/onnx")
+	onnx_path, version = export_onnx(weights_path, "models/onnx", arch=arch, scale=scale)
 	print(f"Ready for C++ inference: {onnx_path}", flush=True)
 
 if __name__ == "__main__":
-	train("data\\train\\HR")
\ No newline at end of file
+	parser = argparse.ArgumentParser(description="Train a super-resolution model and export it to ONNX")
+	parser.add_argument("--arch", choices=["srcnn", "espcn"], default="srcnn",
+		help="srcnn trains on bicubic upscaled inputs, espcn on the low resolution image")
+	parser.add_argument("--scale", type=int, default=2)
+	parser.add_argument("--data", default="data\\train\\HR")
+	args = parser.parse_args()
+	train(args.data, scale=args.scale, arch=args.arch)
\ No newline at end of file
@@ -5,12 +5,26 @@
 #include <chrono>
 #include <map>
 #include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <numeric>
+#include <cmath>
+#include <functional>
 #include "core/Image.h"
 #include "core/Scaler.h"
+#include "core/BatchRunner.h"
+#include "core/MemoryStats.h"
+#include "core/Pipeline.h"
+#include "core/ThreadBudget.h"
+#include "core/Trace.h"
 #include "interpolation/IInterpolator.h"
 #include "interpolation/Bilinear.h"
 #include "interpolation/Bicubic.h"
 #include "metrics/Metrics.h"
+#include "metrics/OriginalCache.h"
+#include "metrics/TileReport.h"
+#include "report/ResultRecord.h"
+#include "report/Regression.h"
 #include "srcnn/SRCNNUpscaler.h"
 
 const std::string PATH_TO_DATA = "../../../../data/";
@@ -23,6 +37,9 @@ const std::string PATH_TO_ONNX_MODELS = "../../../../models/onnx/";
 
 
 static std::string generate_key(std::string key);
+static MetricOptions metric_options_for(const MetricOptions& defaults, int scale_factor);
+static void report_tiles(const SSIMTileMap& tiles, const std::string& heatmap_path, std::ostream& out);
+static double output_megapixels(const Image& image);
 
 struct MetricResult {
 	std::string filename;
@@ -30,14 +47,77 @@ struct MetricResult {
 	std::string scale;
 	double psnr;
 	double ssim;
+	double ms_ssim;
 	long long time_ms;
+	MemoryUsage compute_memory; // the upscale
+	MemoryUsage metrics_memory; // PSNR, SSIM and MS-SSIM against the original
+	double megapixels = 0.0; // of the upscaled output
 };
 
+// One downscaled input on its way through decode -> upscale -> metrics -> encode. The result and
+// console output are produced on workers and reported in directory order.
+struct BatchItem {
+	std::filesystem::path input;
+	std::string filename;
+	std::string key;
+	Image source;
+	Image upscaled;
+	long long time_ms = 0;
+	MemoryUsage compute_memory;
+	MetricResult result;
+	std::string log;
+};
+
+// Workers per stage of the staged batch pipeline. With compute == 0 each job runs whole items instead.
+struct PipelineConfig {
+	int decode = 1;
+	int compute = 0;
+	int metrics = 1;
+	int encode = 1;
+	bool enabled() const { return compute > 0; }
+};
+
+static std::vector<BatchItem> collect_inputs(const std::filesystem::path& downscaled_dir, const OriginalCache& originals);
+static void run_batch(
+	std::vector<BatchItem>& items,
+	const std::string& label,
+	const std::string& output_prefix,
+	const std::function<void(BatchItem&)>& compute,
+	const std::function<void(BatchItem&)>& score,
+	const PipelineConfig& pipeline,
+	std::vector<MetricResult>& results);
+static void time_upscale(BatchItem& item, const std::function<Image(Image&)>& upscale);
+static void score_item(
+	BatchItem& item,
+	OriginalCache& originals,
+	const MetricOptions& metric_options,
+	const std::string& method_name,
+	const std::string& scale_label,
+	const std::string& output_dir);
+
 struct IneterpolatorInfo {
 	std::string name;
 	IInterpolator& interpolator;
 };
 
+struct RunConfig {
+	std::string ort_cache_dir;
+	int threads = 0; // 0 = hardware_concurrency
+	int jobs = 1; // images upscaled and scored concurrently
+	std::vector<int> srcnn_buckets;
+	float srcnn_adaptive_threshold = -1.0f; // < 0 disables the adaptive comparison
+	MetricOptions metrics{ ColorSpace::Luma }; // border is set per scale
+	PipelineConfig pipeline;
+	bool fast_ssim_report = false; // compare fast SSIM against SSIM instead of running the benchmark
+	std::string json_path;
+	std::string csv_path;
+	std::string baseline_path; // compare against this earlier --json/--csv output
+	RegressionThresholds thresholds;
+	std::string trace_path; // Chrome trace of the probes; needs a build with UPSCALER_TRACING
+	bool trace_counters = false; // attach hardware counter deltas to the trace events (Linux)
+	int originals_budget_mb = 2048; // decoded originals and their reference contexts; 0 = no limit
+};
+
 struct ScaleConfig {
 	std::string label;
 	std::string path;
@@ -48,8 +128,13 @@ struct ScaleConfig {
 struct Accumulator {
 	double psnr_sum = 0.0;
 	double ssim_sum = 0.0;
+	double ms_ssim_sum = 0.0;
 	long long time_sum = 0;
 	int count = 0;
+	double compute_mb_sum = 0.0;
+	double metrics_mb_sum = 0.0;
+	int memory_count = 0;
+	double peak_rss_mb = -1.0;
 };
 
 static void run_upscale(
@@ -58,38 +143,25 @@ static void run_upscale(
 	int scale_factor,
 	IInterpolator& interpolator,
 	const std::string& method_name,
-	std::map<std::string, Image>& original_images,
+	OriginalCache& originals,
+	const MetricOptions& metric_defaults,
+	const PipelineConfig& pipeline,
 	std::vector<MetricResult>& results)
 {
+	const MetricOptions metric_options = metric_options_for(metric_defaults, scale_factor);
 	std::string output_dir = PATH_TO_RESULTS + method_name + scale_label + "/";
 	std::filesystem::create_directories(output_dir);
 
-	for (const auto& entry : std::filesystem::directory_iterator(downscaled_dir)) {
-		std::string filename = entry.path().filename().string();
-		std::string key = generate_key(filename);
-		auto found = original_images.find(key);
-		if (found == original_images.end()) {
-			std::cerr << "Original not found for: " << key << std::endl;
-			continue;
-		}
-		Image img;
-		img.loadFromFile(entry.path().string());
-		std::chrono::steady_clock::time_point start = std::chrono::high_resolution_clock::now();
-		Image upscaledImg = Scaler::upscale(img, img.getWidth() * scale_factor, img.getHeight() * scale_factor, interpolator);
-		std::chrono::steady_clock::time_point  end = std::chrono::high_resolution_clock::now();
-		long long duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-		
-		double psnr = Metrics::calculatePSNR(found->second, upscaledImg);
-		double ssim = Metrics::calculateSSIM(found->second, upscaledImg);
-
-		std::cout << "[" << method_name << " " << scale_label << "] " << filename
-			<< " - PSNR " << psnr << "dB"
-			<< ", SSIM: " << ssim
-			<< ", Time: " << duration_ms << "ms\n";
-
-		results.push_back({ filename, method_name, scale_label, psnr, ssim, duration_ms });
-		upscaledImg.saveToFile(output_dir + "upscaled_" + scale_label + "-" + filename);
-	}
+	std::vector<BatchItem> items = collect_inputs(downscaled_dir, originals);
+	auto compute = [&](BatchItem& item) {
+		time_upscale(item, [&](Image& img) {
+			return Scaler::upscale(img, img.getWidth() * scale_factor, img.getHeight() * scale_factor, interpolator);
+		});
+	};
+	auto score = [&](BatchItem& item) {
+		score_item(item, originals, metric_options, method_name, scale_label, output_dir);
+	};
+	run_batch(items, method_name + " " + scale_label, output_dir + "upscaled_" + scale_label + "-", compute, score, pipeline, results);
 }
 
 static void run_srcnn_upscale(
@@ -97,38 +169,329 @@ static void run_srcnn_upscale(
 	const std::string& scale_label,
 	int scale_factor,
 	SRCNNUpscaler& srcnn,
-	std::map<std::string, Image>& original_images,
+	OriginalCache& originals,
+	const MetricOptions& metric_defaults,
+	const PipelineConfig& pipeline,
 	std::vector<MetricResult>& results)
 {
+	const MetricOptions metric_options = metric_options_for(metric_defaults, scale_factor);
 	std::string method_name = srcnn.get_model_name();
 	std::string output_dir = PATH_TO_RESULTS + method_name + "/" + scale_label + "/";
 	std::filesystem::create_directories(output_dir);
+
+	std::vector<BatchItem> items = collect_inputs(downscaled_dir, originals);
+	auto compute = [&](BatchItem& item) {
+		time_upscale(item, [&](Image& img) { return srcnn.upscale(img, scale_factor); });
+	};
+	auto score = [&](BatchItem& item) {
+		score_item(item, originals, metric_options, method_name, scale_label, output_dir);
+	};
+	run_batch(items, method_name + " " + scale_label, output_dir + "upscaled_" + scale_label + "-", compute, score, pipeline, results);
+}
+
+/**
+ * Runs every image through the full and the content-adaptive upscaler and reports
+ * the fraction of skipped tiles, the speedup and the quality lost against full inference.
+ */
+static void run_srcnn_adaptive_comparison(
+	const std::filesystem::path& downscaled_dir,
+	const std::string& scale_label,
+	int scale_factor,
+	SRCNNUpscaler& full,
+	SRCNNUpscaler& adaptive,
+	OriginalCache& originals,
+	const MetricOptions& metric_defaults,
+	std::vector<MetricResult>& results)
+{
+	const MetricOptions metric_options = metric_options_for(metric_defaults, scale_factor);
+	std::string method_name = adaptive.get_model_name() + "-adaptive";
+	SRCNNRunStats stats;
+	double full_ms_sum = 0.0, adaptive_ms_sum = 0.0;
+	double psnr_delta_sum = 0.0, ssim_delta_sum = 0.0;
+	int count = 0;
+
 	for (const auto& entry : std::filesystem::directory_iterator(downscaled_dir)) {
 		std::string filename = entry.path().filename().string();
 		std::string key = generate_key(filename);
-		auto found = original_images.find(key);
-		if (found == original_images.end()) {
+		if (!originals.contains(key)) {
 			std::cerr << "Original not found for: " << key << std::endl;
 			continue;
 		}
 		Image img;
 		img.loadFromFile(entry.path().string());
-		auto start = std::chrono::high_resolution_clock::now();
-		Image upscaledImg = srcnn.upscale(img, scale_factor);
-		auto end = std::chrono::high_resolution_clock::now();
-		long long duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
-		double psnr = Metrics::calculatePSNR(found->second, upscaledImg);
-		double ssim = Metrics::calculateSSIM(found->second, upscaledImg);
+		auto start = std::chrono::steady_clock::now();
+		Image full_img = full.upscale(img, scale_factor);
+		MemoryStats::Phase compute_phase;
+		auto mid = std::chrono::steady_clock::now();
+		Image adaptive_img = adaptive.upscale(img, scale_factor, &stats);
+		auto end = std::chrono::steady_clock::now();
+		MemoryUsage compute_memory = compute_phase.finish();
+
+		double full_ms = std::chrono::duration<double, std::milli>(mid - start).count();
+		double adaptive_ms = std::chrono::duration<double, std::milli>(end - mid).count();
+		OriginalCache::Pin original = originals.acquire(key);
+		const ReferenceContext& reference = original.reference(metric_options);
+		MemoryStats::Phase metrics_phase;
+		MetricSet adaptive_metrics = Metrics::evaluate(reference, adaptive_img.view());
+		MemoryUsage metrics_memory = metrics_phase.finish();
+		MetricSet full_metrics = Metrics::evaluate(reference, full_img.view());
+		double psnr = adaptive_metrics.psnr;
+		double ssim = adaptive_metrics.ssim;
+		double psnr_delta = psnr - full_metrics.psnr;
+		double ssim_delta = ssim - full_metrics.ssim;
+		double ms_ssim = Metrics::calculateMSSSIM(reference, adaptive_img.view());
 
 		std::cout << "[" << method_name << " " << scale_label << "] " << filename
-			<< " - PSNR: " << psnr << "dB"
-			<< ", SSIM: " << ssim
-			<< ", Time: " << duration_ms << "ms\n";
+			<< " - PSNR: " << psnr << "dB (" << psnr_delta << ")"
+			<< ", SSIM: " << ssim << " (" << ssim_delta << ")"
+			<< ", Speedup: " << full_ms / adaptive_ms << "x\n";
+
+		results.push_back({ filename, method_name, scale_label, psnr, ssim, ms_ssim, static_cast<long long>(adaptive_ms),
+			compute_memory, metrics_memory, output_megapixels(adaptive_img) });
+		full_ms_sum += full_ms;
+		adaptive_ms_sum += adaptive_ms;
+		psnr_delta_sum += psnr_delta;
+		ssim_delta_sum += ssim_delta;
+		count++;
+	}
+
+	if (count == 0 || stats.tiles_total == 0) {
+		return;
+	}
+	std::cout << "[" << method_name << " " << scale_label << "] "
+		<< "Tiles skipped: " << 100.0 * stats.tiles_skipped / stats.tiles_total << "%"
+		<< ", Speedup: " << full_ms_sum / adaptive_ms_sum << "x"
+		<< ", Avg PSNR delta: " << psnr_delta_sum / count << "dB"
+		<< ", Avg SSIM delta: " << ssim_delta_sum / count << "\n";
+}
+
+static double pearson_correlation(const std::vector<double>& a, const std::vector<double>& b) {
+	double mean_a = std::accumulate(a.begin(), a.end(), 0.0) / a.size();
+	double mean_b = std::accumulate(b.begin(), b.end(), 0.0) / b.size();
+	double cov = 0.0, var_a = 0.0, var_b = 0.0;
+	for (size_t i = 0; i < a.size(); i++) {
+		cov += (a[i] - mean_a) * (b[i] - mean_b);
+		var_a += (a[i] - mean_a) * (a[i] - mean_a);
+		var_b += (b[i] - mean_b) * (b[i] - mean_b);
+	}
+	return cov / std::sqrt(var_a * var_b);
+}
+
+// Rank of every value, ties sharing their average rank
+static std::vector<double> ranks(const std::vector<double>& values) {
+	std::vector<size_t> order(values.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](size_t i, size_t j) { return values[i] < values[j]; });
+	std::vector<double> result(values.size());
+	for (size_t i = 0; i < order.size();) {
+		size_t j = i;
+		while (j + 1 < order.size() && values[order[j + 1]] == values[order[i]]) {
+			j++;
+		}
+		for (size_t k = i; k <= j; k++) {
+			result[order[k]] = (i + j) / 2.0;
+		}
+		i = j + 1;
+	}
+	return result;
+}
+
+/**
+ * Upscales every downscaled input with every interpolator and scores the outputs with both
+ * the Gaussian-window SSIM and the box-window fast SSIM, then reports how well the fast mode
+ * tracks the standard one (Pearson on values, Spearman on ranking) and what it saves.
+ */
+static void run_fast_ssim_report(
+	const std::vector<ScaleConfig>& scales,
+	const std::vector<IneterpolatorInfo>& interpolation_methods,
+	OriginalCache& originals,
+	const MetricOptions& metric_defaults)
+{
+	std::vector<double> standard, fast;
+	double standard_ms = 0.0, fast_ms = 0.0;
+
+	for (const auto& method : interpolation_methods) {
+		for (const auto& scale : scales) {
+			const MetricOptions metric_options = metric_options_for(metric_defaults, scale.factor);
+			for (const auto& entry : std::filesystem::directory_iterator(scale.path)) {
+				std::string key = generate_key(entry.path().filename().string());
+				if (!originals.contains(key)) {
+					continue;
+				}
+				Image img;
+				img.loadFromFile(entry.path().string());
+				Image upscaled = Scaler::upscale(img, img.getWidth() * scale.factor, img.getHeight() * scale.factor, method.interpolator);
+				OriginalCache::Pin pin = originals.acquire(key);
+				const Image& original = pin.image();
+
+				auto start = std::chrono::steady_clock::now();
+				double ssim = metric_options.space == ColorSpace::Luma
+					? Metrics::calculateLumaSSIM(original, upscaled, metric_options.border)
+					: Metrics::calculateSSIM(original, upscaled);
+				auto mid = std::chrono::steady_clock::now();
+				double fast_ssim = Metrics::calculateFastSSIM(original, upscaled, metric_options);
+				auto end = std::chrono::steady_clock::now();
+
+				standard_ms += std::chrono::duration<double, std::milli>(mid - start).count();
+				fast_ms += std::chrono::duration<double, std::milli>(end - mid).count();
+				standard.push_back(ssim);
+				fast.push_back(fast_ssim);
+				std::cout << "[" << method.name << " " << scale.label << "] " << key
+					<< " - SSIM: " << ssim << ", fast SSIM: " << fast_ssim << "\n";
+			}
+		}
+	}
+
+	if (standard.size() < 2) {
+		std::cout << "Not enough images for a fast SSIM correlation report\n";
+		return;
+	}
+	double abs_diff_sum = 0.0, max_abs_diff = 0.0;
+	for (size_t i = 0; i < standard.size(); i++) {
+		double diff = std::abs(fast[i] - standard[i]);
+		abs_diff_sum += diff;
+		max_abs_diff = (std::max)(max_abs_diff, diff);
+	}
+	std::cout << "\nFast SSIM vs SSIM over " << standard.size() << " images"
+		<< " - Pearson: " << pearson_correlation(standard, fast)
+		<< ", Spearman: " << pearson_correlation(ranks(standard), ranks(fast))
+		<< ", Mean |diff|: " << abs_diff_sum / standard.size()
+		<< ", Max |diff|: " << max_abs_diff
+		<< ", Speedup: " << standard_ms / fast_ms << "x\n";
+}
+
+// Downscaled inputs that have a matching original, in directory order
+static std::vector<BatchItem> collect_inputs(const std::filesystem::path& downscaled_dir, const OriginalCache& originals) {
+	std::vector<BatchItem> items;
+	for (const auto& entry : std::filesystem::directory_iterator(downscaled_dir)) {
+		std::string filename = entry.path().filename().string();
+		std::string key = generate_key(filename);
+		if (!originals.contains(key)) {
+			std::cerr << "Original not found for: " << key << std::endl;
+			continue;
+		}
+		BatchItem item;
+		item.input = entry.path();
+		item.filename = filename;
+		item.key = key;
+		items.push_back(std::move(item));
+	}
+	return items;
+}
+
+// Upscales the item's source, recording the wall time and the memory of the upscale alone
+static void time_upscale(BatchItem& item, const std::function<Image(Image&)>& upscale) {
+	MemoryStats::Phase memory;
+	auto start = std::chrono::steady_clock::now();
+	item.upscaled = upscale(item.source);
+	auto end = std::chrono::steady_clock::now();
+	item.compute_memory = memory.finish();
+	item.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+}
+
+/**
+ * Scores the item's upscaled image against its original, writes the SSIM heatmap and fills in the
+ * item's result and console log.
+ */
+static void score_item(
+	BatchItem& item,
+	OriginalCache& originals,
+	const MetricOptions& metric_options,
+	const std::string& method_name,
+	const std::string& scale_label,
+	const std::string& output_dir)
+{
+	MetricSet metrics;
+	double ms_ssim;
+	MemoryUsage metrics_memory;
+	{
+		// Decoding the original and building its reference are cache costs, charged to whichever
+		// method gets there first, so they stay outside the metric phase
+		OriginalCache::Pin original = originals.acquire(item.key);
+		const ReferenceContext& reference = original.reference(metric_options);
+		MemoryStats::Phase memory;
+		metrics = Metrics::evaluate(reference, item.upscaled.view());
+		ms_ssim = Metrics::calculateMSSSIM(reference, item.upscaled.view());
+		metrics_memory = memory.finish();
+	}
+
+	std::ostringstream log;
+	log << "[" << method_name << " " << scale_label << "] " << item.filename
+		<< " - PSNR: " << metrics.psnr << "dB"
+		<< ", SSIM: " << metrics.ssim
+		<< ", MS-SSIM: " << ms_ssim
+		<< ", MAE: " << metrics.mae
+		<< ", Max error: " << metrics.max_error
+		<< ", Time: " << item.time_ms << "ms\n";
+
+	report_tiles(metrics.tiles, output_dir + "heatmap_" + scale_label + "-" + std::filesystem::path(item.filename).stem().string() + ".png", log);
+
+	item.result = { item.filename, method_name, scale_label, metrics.psnr, metrics.ssim, ms_ssim, item.time_ms,
+		item.compute_memory, metrics_memory, output_megapixels(item.upscaled) };
+	item.log = log.str();
+}
+
+static void print_stage_stats(const std::string& label, const std::vector<StageStats>& stages) {
+	std::ios state(nullptr);
+	state.copyfmt(std::cout);
+	std::cout << "Pipeline stages [" << label << "]\n" << std::fixed << std::setprecision(1);
+	for (const auto& stage : stages) {
+		const double worker_ms = stage.wall_ms * stage.workers;
+		std::cout << "  " << std::left << std::setw(8) << stage.name << std::right
+			<< " x" << stage.workers
+			<< " - items: " << stage.items
+			<< ", busy: " << 100.0 * stage.utilization() << "%"
+			<< ", blocked on next stage: " << (worker_ms > 0.0 ? 100.0 * stage.blocked_ms / worker_ms : 0.0) << "%\n";
+	}
+	std::cout.copyfmt(state);
+}
+
+/**
+ * Decodes, upscales, scores and encodes every item, then prints each item's log and collects its
+ * result in input order. In pipeline mode every step is a stage with its own workers and bounded
+ * queues in between, so a slow PNG encode overlaps the next upscale instead of delaying it;
+ * otherwise ThreadBudget::concurrent_jobs() workers each take whole items.
+ * Encoding releases an item's images, which keeps memory bounded by the items in flight.
+ */
+static void run_batch(
+	std::vector<BatchItem>& items,
+	const std::string& label,
+	const std::string& output_prefix,
+	const std::function<void(BatchItem&)>& compute,
+	const std::function<void(BatchItem&)>& score,
+	const PipelineConfig& pipeline,
+	std::vector<MetricResult>& results)
+{
+	auto decode = [&](size_t i) {
+		items[i].source.loadFromFile(items[i].input.string());
+	};
+	auto encode = [&](size_t i) {
+		items[i].upscaled.saveToFile(output_prefix + items[i].filename);
+		items[i].source = Image();
+		items[i].upscaled = Image();
+	};
+	auto commit = [&](size_t i) {
+		std::cout << items[i].log;
+		results.push_back(items[i].result);
+	};
 
-		results.push_back({ filename, method_name, scale_label, psnr, ssim, duration_ms });
-		upscaledImg.saveToFile(output_dir + "upscaled_" + scale_label + "-" + filename);
+	if (!pipeline.enabled()) {
+		BatchRunner::run(items.size(), ThreadBudget::concurrent_jobs(), [&](size_t i) {
+			decode(i);
+			compute(items[i]);
+			score(items[i]);
+			encode(i);
+		}, commit);
+		return;
 	}
+
+	Pipeline stages;
+	stages.add_stage("decode", pipeline.decode, decode);
+	stages.add_stage("compute", pipeline.compute, [&](size_t i) { compute(items[i]); });
+	stages.add_stage("metrics", pipeline.metrics, [&](size_t i) { score(items[i]); });
+	stages.add_stage("encode", pipeline.encode, encode);
+	print_stage_stats(label, stages.run(items.size(), commit));
 }
 
 static std::string generate_key(std::string key) {
@@ -137,14 +500,228 @@ static std::string generate_key(std::string key) {
 	return key.substr(start_pos, end_pos);
 }
 
+// Y-channel numbers shave a scale-sized border, matching how published SR results are measured
+static MetricOptions metric_options_for(const MetricOptions& defaults, int scale_factor) {
+	MetricOptions options = defaults;
+	options.border = defaults.space == ColorSpace::Luma ? scale_factor : 0;
+	return options;
+}
+
+static double output_megapixels(const Image& image) {
+	return static_cast<double>(image.getWidth()) * image.getHeight() / 1e6;
+}
+
+// Working memory of a phase per output megapixel, -1 when it was not measured
+static double mb_per_mp(const MemoryUsage& usage, double megapixels) {
+	return usage.working_bytes() >= 0 && megapixels > 0.0 ? usage.working_bytes() / BYTES_PER_MB / megapixels : -1.0;
+}
+
+// Resident high-water over both phases of a result, in MB; -1 when the platform cannot say
+static double peak_rss_mb(const MetricResult& result) {
+	long long peak = (std::max)(result.compute_memory.peak_rss_bytes, result.metrics_memory.peak_rss_bytes);
+	return peak >= 0 ? peak / BYTES_PER_MB : -1.0;
+}
+
+// Number of worst tiles listed per image when per-tile SSIM is collected
+constexpr int WORST_TILES = 5;
+
+static void report_tiles(const SSIMTileMap& tiles, const std::string& heatmap_path, std::ostream& out) {
+	if (tiles.empty()) {
+		return;
+	}
+	if (!TileReport::writeHeatmap(tiles, heatmap_path)) {
+		std::cerr << "Failed to write heatmap: " << heatmap_path << std::endl;
+	}
+	out << "  Worst tiles:";
+	for (const auto& tile : TileReport::worstTiles(tiles, WORST_TILES)) {
+		out << " (" << tile.x << ", " << tile.y << ") " << tile.ssim << ";";
+	}
+	out << "\n";
+}
+
+static std::vector<int> parse_int_list(const std::string& list) {
+	std::vector<int> values;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			values.push_back(std::atoi(item.c_str()));
+		}
+	}
+	return values;
+}
+
+static RunConfig parse_args(int argc, char* argv[]) {
+	RunConfig config;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--ort-cache" && i + 1 < argc) {
+			config.ort_cache_dir = argv[++i];
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			config.threads = std::atoi(argv[++i]);
+		}
+		else if (arg == "--jobs" && i + 1 < argc) {
+			config.jobs = (std::max)(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--pipeline" && i + 1 < argc) {
+			std::vector<int> workers = parse_int_list(argv[++i]);
+			if (workers.size() == 4) {
+				config.pipeline = { (std::max)(1, workers[0]), (std::max)(1, workers[1]), (std::max)(1, workers[2]), (std::max)(1, workers[3]) };
+			}
+			else {
+				std::cerr << "--pipeline expects decode,compute,metrics,encode worker counts" << std::endl;
+			}
+		}
+		else if (arg == "--srcnn-adaptive" && i + 1 < argc) {
+			config.srcnn_adaptive_threshold = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "--srcnn-buckets" && i + 1 < argc) {
+			config.srcnn_buckets = parse_int_list(argv[++i]);
+		}
+		else if (arg == "--rgb-metrics") {
+			config.metrics.space = ColorSpace::RGB;
+		}
+		else if (arg == "--tile-report" && i + 1 < argc) {
+			config.metrics.tile_size = std::atoi(argv[++i]);
+		}
+		else if (arg == "--fast-ssim-report") {
+			config.fast_ssim_report = true;
+		}
+		else if (arg == "--json" && i + 1 < argc) {
+			config.json_path = argv[++i];
+		}
+		else if (arg == "--csv" && i + 1 < argc) {
+			config.csv_path = argv[++i];
+		}
+		else if (arg == "--baseline" && i + 1 < argc) {
+			config.baseline_path = argv[++i];
+		}
+		else if (arg == "--max-slowdown" && i + 1 < argc) {
+			config.thresholds.max_slowdown = std::atof(argv[++i]);
+		}
+		else if (arg == "--max-psnr-drop" && i + 1 < argc) {
+			config.thresholds.max_psnr_drop_db = std::atof(argv[++i]);
+		}
+		else if (arg == "--max-ssim-drop" && i + 1 < argc) {
+			config.thresholds.max_ssim_drop = std::atof(argv[++i]);
+		}
+		else if (arg == "--trace" && i + 1 < argc) {
+			config.trace_path = argv[++i];
+		}
+		else if (arg == "--trace-counters") {
+			config.trace_counters = true;
+		}
+		else if (arg == "--originals-budget-mb" && i + 1 < argc) {
+			config.originals_budget_mb = (std::max)(0, std::atoi(argv[++i]));
+		}
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+		}
+	}
+	return config;
+}
+
+static void print_bucket_latencies(const SRCNNUpscaler& srcnn) {
+	auto latencies = srcnn.get_bucket_latencies();
+	if (latencies.empty()) {
+		return;
+	}
+	std::ios state(nullptr);
+	state.copyfmt(std::cout);
+	std::cout << "\nBucket latencies [" << srcnn.get_model_name() << "]\n";
+	for (const auto& b : latencies) {
+		std::cout << "  " << b.size << "x" << b.size
+			<< " - runs: " << b.runs
+			<< ", warmup: " << std::fixed << std::setprecision(2) << b.warmup_ms << "ms"
+			<< ", p50: " << b.p50_ms << "ms"
+			<< ", p99: " << b.p99_ms << "ms\n";
+	}
+	std::cout.copyfmt(state);
+}
+
+// A budget below the originals one pass touches shows up as loads well above the number of originals
+static void print_original_cache(const OriginalCache& originals) {
+	const OriginalCacheStats stats = originals.stats();
+	std::ios state(nullptr);
+	state.copyfmt(std::cout);
+	std::cout << "\nOriginals - loads: " << stats.loads << " of " << originals.size()
+		<< ", hits: " << stats.hits
+		<< ", evictions: " << stats.evictions
+		<< ", peak resident: " << std::fixed << std::setprecision(1) << stats.peak_bytes / BYTES_PER_MB << " MB\n";
+	std::cout.copyfmt(state);
+}
+
+static ResultRecord to_record(const MetricResult& result) {
+	ResultRecord record;
+	record.set("filename", result.filename);
+	record.set("method", result.method);
+	record.set("scale", result.scale);
+	record.set("psnr", result.psnr);
+	record.set("ssim", result.ssim);
+	record.set("ms_ssim", result.ms_ssim);
+	record.set("time_ms", static_cast<double>(result.time_ms));
+	// Figures this platform or build cannot measure are left out, the same for every record of a run
+	auto set_measured = [&](const std::string& field, double value) {
+		if (value >= 0.0) {
+			record.set(field, value);
+		}
+	};
+	set_measured("compute_mb_per_mp", mb_per_mp(result.compute_memory, result.megapixels));
+	set_measured("compute_allocations", static_cast<double>(result.compute_memory.allocations));
+	set_measured("metrics_mb_per_mp", mb_per_mp(result.metrics_memory, result.megapixels));
+	set_measured("metrics_allocations", static_cast<double>(result.metrics_memory.allocations));
+	set_measured("peak_rss_mb", peak_rss_mb(result));
+	return record;
+}
+
+/**
+ * Writes the machine-readable copies of the results and, with a baseline, reports quality
+ * drops and timing regressions against it. Returns the number of regressions.
+ */
+static int export_results(const RunConfig& config, const std::vector<MetricResult>& results) {
+	std::vector<ResultRecord> records;
+	for (const auto& result : results) {
+		records.push_back(to_record(result));
+	}
+	if (!config.json_path.empty()) {
+		ResultIO::writeJson(config.json_path, "results", records);
+	}
+	if (!config.csv_path.empty()) {
+		ResultIO::writeCsv(config.csv_path, records);
+	}
+	if (config.baseline_path.empty()) {
+		return 0;
+	}
+	std::vector<ResultRecord> baseline;
+	if (!ResultIO::load(config.baseline_path, baseline)) {
+		return 0;
+	}
+	std::cout << "\nBaseline " << config.baseline_path << "\n";
+	return Regression::report(Regression::compareResults(baseline, records, config.thresholds), std::cout);
+}
+
 static void print_summary(const std::vector<MetricResult>& results) {
 	constexpr int col_file = 25;
 	constexpr int col_method = 20;
 	constexpr int col_scale = 7;
 	constexpr int col_psnr = 12;
 	constexpr int col_ssim = 10;
+	constexpr int col_ms_ssim = 12;
 	constexpr int col_time = 10;
-	constexpr int total_width = col_file + col_method + col_scale + col_psnr + col_ssim + col_time + 7;
+	constexpr int col_mb = 9;
+	constexpr int col_rss = 10;
+	constexpr int total_width = col_file + col_method + col_scale + col_psnr + col_ssim + col_ms_ssim + col_time + 2 * col_mb + col_rss + 7;
+
+	// Unmeasured memory figures print as a dash
+	auto memory_cell = [](double value) {
+		if (value < 0.0) {
+			return std::string("-");
+		}
+		std::ostringstream cell;
+		cell << std::fixed << std::setprecision(1) << value;
+		return cell.str();
+	};
 
 	auto separator = [&]() {
 		std::cout << std::string(total_width, '-') << "\n";
@@ -161,7 +738,11 @@ static void print_summary(const std::vector<MetricResult>& results) {
 		<< std::setw(col_scale) << "Scale"
 		<< std::setw(col_psnr) << "PSNR (dB)"
 		<< std::setw(col_ssim) << "SSIM"
+		<< std::setw(col_ms_ssim) << "MS-SSIM"
 		<< std::setw(col_time) << "Time (ms)"
+		<< std::setw(col_mb) << "MB/MP"
+		<< std::setw(col_mb) << "Met MB/MP"
+		<< std::setw(col_rss) << "RSS (MB)"
 		<< " |\n";
 	separator();
 
@@ -172,7 +753,11 @@ static void print_summary(const std::vector<MetricResult>& results) {
 			<< std::setw(col_scale) << r.scale
 			<< std::setw(col_psnr) << std::fixed << std::setprecision(2) << r.psnr
 			<< std::setw(col_ssim) << std::fixed << std::setprecision(4) << r.ssim
+			<< std::setw(col_ms_ssim) << r.ms_ssim
 			<< std::setw(col_time) << r.time_ms
+			<< std::setw(col_mb) << memory_cell(mb_per_mp(r.compute_memory, r.megapixels))
+			<< std::setw(col_mb) << memory_cell(mb_per_mp(r.metrics_memory, r.megapixels))
+			<< std::setw(col_rss) << memory_cell(peak_rss_mb(r))
 			<< " |\n";
 	}
 
@@ -184,8 +769,17 @@ static void print_summary(const std::vector<MetricResult>& results) {
 		auto& acc = averages[group];
 		acc.psnr_sum += r.psnr;
 		acc.ssim_sum += r.ssim;
+		acc.ms_ssim_sum += r.ms_ssim;
 		acc.time_sum += r.time_ms;
 		acc.count++;
+		const double compute_mb = mb_per_mp(r.compute_memory, r.megapixels);
+		const double metrics_mb = mb_per_mp(r.metrics_memory, r.megapixels);
+		if (compute_mb >= 0.0 && metrics_mb >= 0.0) {
+			acc.compute_mb_sum += compute_mb;
+			acc.metrics_mb_sum += metrics_mb;
+			acc.memory_count++;
+		}
+		acc.peak_rss_mb = (std::max)(acc.peak_rss_mb, peak_rss_mb(r));
 	}
 
 	std::cout << "\n";
@@ -198,13 +792,18 @@ static void print_summary(const std::vector<MetricResult>& results) {
 		<< std::setw(col_scale) << "Count"
 		<< std::setw(col_psnr) << "Avg PSNR"
 		<< std::setw(col_ssim) << "Avg SSIM"
+		<< std::setw(col_ms_ssim) << "Avg MS-SSIM"
 		<< std::setw(col_time) << "Avg Time"
+		<< std::setw(col_mb) << "MB/MP"
+		<< std::setw(col_mb) << "Met MB/MP"
+		<< std::setw(col_rss) << "Max RSS"
 		<< " |\n";
 	separator();
 
 	for (const auto& [group, acc] : averages) {
 		double avg_psnr = acc.psnr_sum / acc.count;
 		double avg_ssim = acc.ssim_sum / acc.count;
+		double avg_ms_ssim = acc.ms_ssim_sum / acc.count;
 		long long avg_time = acc.time_sum / acc.count;
 
 		std::cout << "| " << std::left
@@ -212,23 +811,62 @@ static void print_summary(const std::vector<MetricResult>& results) {
 			<< std::setw(col_scale) << acc.count
 			<< std::setw(col_psnr) << std::fixed << std::setprecision(2) << avg_psnr
 			<< std::setw(col_ssim) << std::fixed << std::setprecision(4) << avg_ssim
+			<< std::setw(col_ms_ssim) << avg_ms_ssim
 			<< std::setw(col_time) << avg_time
+			<< std::setw(col_mb) << memory_cell(acc.memory_count > 0 ? acc.compute_mb_sum / acc.memory_count : -1.0)
+			<< std::setw(col_mb) << memory_cell(acc.memory_count > 0 ? acc.metrics_mb_sum / acc.memory_count : -1.0)
+			<< std::setw(col_rss) << memory_cell(acc.peak_rss_mb)
 			<< " |\n";
 	}
 
 	separator();
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	std::map<std::string, Image> original_images;
-
+	RunConfig config = parse_args(argc, argv);
+	// Pipeline mode runs compute and metrics workers side by side; decode and encode are I/O bound
+	const PipelineConfig& pipeline = config.pipeline;
+	ThreadBudget::configure(config.threads, pipeline.enabled() ? pipeline.compute + pipeline.metrics : config.jobs);
+	std::cout << "Thread budget: " << ThreadBudget::total() << " threads";
+	if (ThreadBudget::concurrent_jobs() > 1) {
+		std::cout << ", " << ThreadBudget::concurrent_jobs() << " concurrent jobs of " << ThreadBudget::per_job();
+	}
+	std::cout << std::endl;
+	if (pipeline.enabled()) {
+		std::cout << "Pipeline workers: decode " << pipeline.decode << ", compute " << pipeline.compute
+			<< ", metrics " << pipeline.metrics << ", encode " << pipeline.encode << std::endl;
+	}
+	std::cout << "Metrics: " << (config.metrics.space == ColorSpace::Luma ? "Y channel, scale-pixel border shaved" : "RGB average") << std::endl;
+	if (config.metrics.tile_size > 0) {
+		std::cout << "Per-tile SSIM: " << config.metrics.tile_size << "px tiles, heatmaps next to the upscaled images" << std::endl;
+	}
+	std::cout << "Memory: " << (MemoryStats::hooked() ? "heap high-water and allocations per phase" : "resident set only, no allocation hook")
+		<< ((ThreadBudget::concurrent_jobs() > 1 || pipeline.enabled()) ? "; concurrent items share the figures" : "") << std::endl;
+	if (!config.trace_path.empty()) {
+#ifdef UPSCALER_TRACE
+		TRACE_THREAD_NAME("main");
+		std::string reason;
+		if (config.trace_counters && !PerfCounters::supported(reason)) {
+			std::cout << "Hardware counters unavailable: " << reason << "; tracing time only" << std::endl;
+		}
+		Trace::start(config.trace_counters);
+#else
+		std::cerr << "--trace ignored: this build has no probes, configure with -DUPSCALER_TRACING=ON" << std::endl;
+		config.trace_path.clear();
+#endif
+	}
+	// Only indexed here; each original is decoded by the first comparison against it
+	OriginalCache originals(static_cast<size_t>(config.originals_budget_mb) * 1024 * 1024);
 	for (const auto& entry : std::filesystem::directory_iterator(PATH_TO_ORIGINALS)) {
-		std::string key = generate_key(entry.path().filename().string());
-		std::cout << "Loading original: " << key << std::endl;
-		Image img;
-		img.loadFromFile(entry.path().string());
-		original_images[key] = img;
+		originals.add(generate_key(entry.path().filename().string()), entry.path());
+	}
+	std::cout << "Originals: " << originals.size() << " indexed, loaded on demand, ";
+	if (originals.budget() > 0) {
+		std::cout << config.originals_budget_mb << " MB budget" << std::endl;
+	}
+	else {
+		std::cout << "no budget" << std::endl;
 	}
 
 	// Interpolators
@@ -245,12 +883,20 @@ int main()
 		{ "4x", PATH_TO_DOWNSCALED_4x, 4 }
 	};
 	
+	if (config.fast_ssim_report) {
+		run_fast_ssim_report(scales, interpolation_methods, originals, config.metrics);
+		if (!config.trace_path.empty()) {
+			Trace::writeChromeTrace(config.trace_path);
+		}
+		return 0;
+	}
+
 	std::vector<MetricResult> all_results;
 
 	for (auto& method : interpolation_methods) {
 		for (auto& scale : scales) {
 			std::cout << "\n===" << method.name << " " << scale.label << "===\n";
-			run_upscale(scale.path, scale.label, scale.factor, method.interpolator, method.name, original_images, all_results);
+			run_upscale(scale.path, scale.label, scale.factor, method.interpolator, method.name, originals, config.metrics, config.pipeline, all_results);
 		}
 	}
 
@@ -265,10 +911,31 @@ int main()
 
 		for (const auto& onnx_path : onnx_files) {
 			try {
-				SRCNNUpscaler srcnn(onnx_path);
+				SRCNNOptions srcnn_options;
+				srcnn_options.cache_dir = config.ort_cache_dir;
+				srcnn_options.bucket_sizes = config.srcnn_buckets;
+				SRCNNUpscaler srcnn(onnx_path, srcnn_options);
 				std::cout << "\n=== SRCNN [" << srcnn.get_model_name() << "] ===\n";
+				if (srcnn.get_model_scale() > 1) {
+					std::cout << "Sub-pixel model, native scale " << srcnn.get_model_scale() << "x\n";
+				}
+				std::cout << "Session created in " << srcnn.get_load_time_ms() << "ms ("
+					<< (config.ort_cache_dir.empty() ? "no cache" : srcnn.is_loaded_from_cache() ? "warm, from cache" : "cold, cache written")
+					<< ")\n";
 				for (auto& scale : scales) {
-					run_srcnn_upscale(scale.path, scale.label, scale.factor, srcnn, original_images, all_results);
+					run_srcnn_upscale(scale.path, scale.label, scale.factor, srcnn, originals, config.metrics, config.pipeline, all_results);
+				}
+				print_bucket_latencies(srcnn);
+
+				if (config.srcnn_adaptive_threshold >= 0.0f) {
+					SRCNNOptions adaptive_options = srcnn_options;
+					adaptive_options.adaptive_threshold = config.srcnn_adaptive_threshold;
+					SRCNNUpscaler adaptive(onnx_path, adaptive_options);
+					std::cout << "\n=== SRCNN [" << adaptive.get_model_name() << "] adaptive, threshold "
+						<< config.srcnn_adaptive_threshold << " ===\n";
+					for (auto& scale : scales) {
+						run_srcnn_adaptive_comparison(scale.path, scale.label, scale.factor, srcnn, adaptive, originals, config.metrics, all_results);
+					}
 				}
 			} 
 			catch (const std::exception& e) {
@@ -280,7 +947,12 @@ int main()
 		std::cout << "\nNo ONNX models found in " << PATH_TO_ONNX_MODELS << std::endl;
 	}
 
+	if (!config.trace_path.empty()) {
+		Trace::writeChromeTrace(config.trace_path);
+	}
+	print_original_cache(originals);
 	print_summary(all_results);
 
-	return 0;
+	// A non-zero exit lets a nightly run fail on regressions
+	return export_results(config, all_results) > 0 ? 3 : 0;
 }
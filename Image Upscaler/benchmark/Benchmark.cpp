@@ -0,0 +1,101 @@
+#include "Benchmark.h"
+#include "../core/Statistics.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+static volatile double sink = 0.0;
+
+bool Benchmark::selected(const std::string& filter, const std::string& name) {
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void Benchmark::do_not_optimize(double value) {
+	sink = value;
+}
+
+BenchmarkResult Benchmark::measure(const std::string& name, int width, int height, const BenchmarkOptions& options, const std::function<void()>& body) {
+	using clock = std::chrono::steady_clock;
+	for (int i = 0; i < options.warmup; i++) {
+		body();
+	}
+
+	const bool counting = options.counters && options.counters->available();
+	const CounterValues counters_before = counting ? options.counters->read() : CounterValues();
+	std::vector<double> samples;
+	double total_ms = 0.0;
+	while (static_cast<int>(samples.size()) < options.max_reps) {
+		clock::time_point start = clock::now();
+		body();
+		double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		samples.push_back(ms);
+		total_ms += ms;
+		if (static_cast<int>(samples.size()) >= options.min_reps && total_ms >= options.budget_ms) {
+			break;
+		}
+	}
+	// Includes the clock reads between repetitions, which are negligible next to any case
+	const CounterValues counters_after = counting ? options.counters->read() : CounterValues();
+
+	BenchmarkResult result;
+	result.name = name;
+	result.width = width;
+	result.height = height;
+	result.reps = static_cast<int>(samples.size());
+	result.min_ms = *std::min_element(samples.begin(), samples.end());
+	result.median_ms = Statistics::percentile(samples, 0.50);
+	result.p95_ms = Statistics::percentile(samples, 0.95);
+	if (counters_before.valid() && counters_after.valid()) {
+		result.counters = (counters_after - counters_before) / static_cast<double>(samples.size());
+	}
+	result.samples_ms = std::move(samples);
+	return result;
+}
+
+void Benchmark::print_header(bool counters) {
+	std::cout << std::left
+		<< std::setw(22) << "Kernel"
+		<< std::setw(12) << "Size"
+		<< std::right
+		<< std::setw(6) << "Reps"
+		<< std::setw(12) << "Min (ms)"
+		<< std::setw(12) << "Median (ms)"
+		<< std::setw(12) << "P95 (ms)"
+		<< std::setw(10) << "MP/s";
+	if (counters) {
+		std::cout << std::setw(8) << "IPC" << std::setw(14) << "LLC miss/MP" << std::setw(14) << "Br miss/MP";
+	}
+	std::cout << "\n" << std::string(counters ? 122 : 86, '-') << "\n";
+}
+
+void Benchmark::print_row(const BenchmarkResult& result, bool counters) {
+	std::ios state(nullptr);
+	state.copyfmt(std::cout);
+	std::cout << std::left
+		<< std::setw(22) << result.label()
+		<< std::setw(12) << (std::to_string(result.width) + "x" + std::to_string(result.height))
+		<< std::right << std::fixed << std::setprecision(3)
+		<< std::setw(6) << result.reps
+		<< std::setw(12) << result.min_ms
+		<< std::setw(12) << result.median_ms
+		<< std::setw(12) << result.p95_ms
+		<< std::setprecision(1)
+		<< std::setw(10) << result.mp_per_s();
+	if (counters) {
+		// Missing events print as a dash rather than a misleading zero
+		auto column = [](int width, double value, int precision) {
+			if (value < 0.0) {
+				std::cout << std::setw(width) << "-";
+			}
+			else {
+				std::cout << std::setprecision(precision) << std::setw(width) << value;
+			}
+		};
+		column(8, result.counters.ipc(), 2);
+		column(14, result.per_mp(result.counters.llc_misses), 0);
+		column(14, result.per_mp(result.counters.branch_misses), 0);
+	}
+	std::cout << std::endl;
+	std::cout.copyfmt(state);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "../core/MemoryStats.h"
+#include "../core/PerfCounters.h"
+
+// Timing of one kernel at one input size. Throughput is taken from the median.
+struct BenchmarkResult {
+	std::string name;
+	int width = 0;
+	int height = 0;
+	int reps = 0;
+	double min_ms = 0.0;
+	double median_ms = 0.0;
+	double p95_ms = 0.0;
+	std::vector<double> samples_ms; // every timed repetition, in run order
+	CounterValues counters; // mean per timed repetition; invalid without counters
+	MemoryUsage memory; // of a cold run before timing; only the resolution sweep measures it
+	int threads = 0; // thread budget of a thread-scaling run, 0 elsewhere
+	double efficiency = -1.0; // parallel efficiency against the run's first thread count, -1 elsewhere
+	// Name as printed and keyed in baselines; thread-scaling runs repeat a size at every thread count
+	std::string label() const { return threads > 0 ? name + "@" + std::to_string(threads) + "t" : name; }
+	double megapixels() const { return static_cast<double>(width) * height / 1e6; }
+	double mp_per_s() const { return median_ms > 0.0 ? megapixels() / (median_ms / 1000.0) : 0.0; }
+	// Counter events per megapixel, -1 when the event was not counted
+	double per_mp(double events) const { return events >= 0.0 && megapixels() > 0.0 ? events / megapixels() : -1.0; }
+};
+
+struct BenchmarkOptions {
+	int warmup = 2;
+	int min_reps = 3;
+	int max_reps = 15;
+	// Repetitions stop early once they have taken this long, so 8K cases stay affordable
+	double budget_ms = 2000.0;
+	// Hardware counters read around the timed repetitions; null or unavailable times only
+	const PerfCounters* counters = nullptr;
+};
+
+/**
+ * Repetition harness for the kernel microbenchmarks. Each case is run warmup times untimed,
+ * then between min_reps and max_reps times against a steady clock. width x height is the
+ * number of pixels the case produces or consumes and only feeds the MP/s column.
+ */
+class Benchmark {
+public:
+	static BenchmarkResult measure(const std::string& name, int width, int height, const BenchmarkOptions& options, const std::function<void()>& body);
+	// Whether a case passes --filter; an empty filter passes every case
+	static bool selected(const std::string& filter, const std::string& name);
+	// Stores value where the optimizer must assume it is read, so the work that produced it stays
+	static void do_not_optimize(double value);
+	static void print_header(bool counters = false);
+	// With counters, a result without them fills the counter columns with dashes
+	static void print_row(const BenchmarkResult& result, bool counters = false);
+};
@@ -0,0 +1,281 @@
+// BenchmarkMain.cpp : Kernel microbenchmark suite, built as UpscalerBenchmark.
+//
+// UpscalerBenchmark [--max-size 4k] [--filter ssim] [--model srcnn.onnx] [--threads N]
+//                   [--warmup N] [--min-reps N] [--reps N] [--budget-ms MS] [--srcnn-max-size 1080p]
+//                   [--json out.json] [--csv out.csv] [--baseline old.json] [--max-slowdown 0.05] [--significance 0.05]
+//                   [--counters]
+// UpscalerBenchmark --sweep 1,4,16,64,200 [--content mixed] [--sweep-scale 2] [--srcnn-max-mp 16] [--filter bicubic] ...
+// UpscalerBenchmark --scaling [--scaling-threads 1,2,4,8] [--scaling-mp 4] [--scaling-mode strong|weak|both] ...
+//
+// --counters adds IPC and LLC/branch misses per megapixel from perf_event_open (Linux). Where the
+// counters cannot be opened, as in most containers, the suite says why and reports timings only.
+// --sweep runs the resolution sweep instead of the kernel suite: each method end to end at the
+// given output sizes in megapixels on generated gradient, noise, text, flat or mixed content.
+// --scaling runs each method at 1, 2, 4 ... --threads threads on a fixed size (strong) and on a
+// size that grows with the thread count (weak), and prints efficiency curves. --content and
+// --sweep-scale apply to both modes.
+//
+// With --baseline the exit code is 3 when any kernel regressed, so the suite can gate a change.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "KernelBenchmarks.h"
+#include "ResolutionSweep.h"
+#include "ThreadScaling.h"
+#include "../core/PerfCounters.h"
+#include "../core/ThreadBudget.h"
+#include "../metrics/ConvolutionSIMD.h"
+#include "../report/ResultRecord.h"
+#include "../report/Regression.h"
+
+struct BenchmarkArgs {
+	SuiteConfig suite;
+	int threads = 0; // 0 = hardware_concurrency
+	std::string max_size = "8k";
+	std::string json_path;
+	std::string csv_path;
+	std::string baseline_path;
+	RegressionThresholds thresholds;
+	bool counters = false;
+	SweepConfig sweep; // runs instead of the kernel suite when it has sizes
+	bool scaling = false; // thread-scaling mode instead of the kernel suite
+	ScalingConfig scaling_config;
+	bool valid = true; // false after an argument the run cannot go ahead with
+};
+
+static std::vector<double> parse_double_list(const std::string& list) {
+	std::vector<double> values;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty() && std::atof(item.c_str()) > 0.0) {
+			values.push_back(std::atof(item.c_str()));
+		}
+	}
+	return values;
+}
+
+// A size label must name one of the standard sizes; an unknown one would never stop the size loop
+static bool parse_size_label(const std::string& option, const std::string& label, std::string& target) {
+	std::string known;
+	for (const auto& size : KernelBenchmarks::standard_sizes()) {
+		if (size.label == label) {
+			target = label;
+			return true;
+		}
+		known += (known.empty() ? "" : ", ") + size.label;
+	}
+	std::cerr << option << " expects one of " << known << ", got " << label << std::endl;
+	return false;
+}
+
+static BenchmarkArgs parse_args(int argc, char* argv[]) {
+	BenchmarkArgs args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--max-size" && i + 1 < argc) {
+			args.valid &= parse_size_label(arg, argv[++i], args.max_size);
+		}
+		else if (arg == "--filter" && i + 1 < argc) {
+			args.suite.filter = argv[++i];
+		}
+		else if (arg == "--model" && i + 1 < argc) {
+			args.suite.model_path = argv[++i];
+		}
+		else if (arg == "--srcnn-max-size" && i + 1 < argc) {
+			args.valid &= parse_size_label(arg, argv[++i], args.suite.srcnn_max_size);
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			args.threads = std::atoi(argv[++i]);
+		}
+		else if (arg == "--warmup" && i + 1 < argc) {
+			args.suite.options.warmup = std::atoi(argv[++i]);
+		}
+		else if (arg == "--min-reps" && i + 1 < argc) {
+			args.suite.options.min_reps = (std::max)(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--reps" && i + 1 < argc) {
+			args.suite.options.max_reps = (std::max)(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--budget-ms" && i + 1 < argc) {
+			args.suite.options.budget_ms = std::atof(argv[++i]);
+		}
+		else if (arg == "--json" && i + 1 < argc) {
+			args.json_path = argv[++i];
+		}
+		else if (arg == "--csv" && i + 1 < argc) {
+			args.csv_path = argv[++i];
+		}
+		else if (arg == "--baseline" && i + 1 < argc) {
+			args.baseline_path = argv[++i];
+		}
+		else if (arg == "--max-slowdown" && i + 1 < argc) {
+			args.thresholds.max_slowdown = std::atof(argv[++i]);
+		}
+		else if (arg == "--significance" && i + 1 < argc) {
+			args.thresholds.significance = std::atof(argv[++i]);
+		}
+		else if (arg == "--counters") {
+			args.counters = true;
+		}
+		else if (arg == "--sweep" && i + 1 < argc) {
+			args.sweep.megapixels = parse_double_list(argv[++i]);
+			std::sort(args.sweep.megapixels.begin(), args.sweep.megapixels.end());
+		}
+		else if (arg == "--content" && i + 1 < argc) {
+			if (!SyntheticImage::parse_content(argv[++i], args.sweep.content)) {
+				std::cerr << "--content expects gradient, noise, text, flat or mixed" << std::endl;
+				args.valid = false;
+			}
+		}
+		else if (arg == "--sweep-scale" && i + 1 < argc) {
+			args.sweep.scale = (std::max)(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--srcnn-max-mp" && i + 1 < argc) {
+			args.sweep.srcnn_max_megapixels = std::atof(argv[++i]);
+		}
+		else if (arg == "--scaling") {
+			args.scaling = true;
+		}
+		else if (arg == "--scaling-threads" && i + 1 < argc) {
+			std::vector<double> threads = parse_double_list(argv[++i]);
+			std::sort(threads.begin(), threads.end());
+			for (double t : threads) {
+				args.scaling_config.threads.push_back((std::max)(1, static_cast<int>(t)));
+			}
+		}
+		else if (arg == "--scaling-mp" && i + 1 < argc) {
+			args.scaling_config.megapixels = (std::max)(0.01, std::atof(argv[++i]));
+		}
+		else if (arg == "--scaling-mode" && i + 1 < argc) {
+			std::string mode = argv[++i];
+			args.scaling_config.strong = mode != "weak";
+			args.scaling_config.weak = mode != "strong";
+		}
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+		}
+	}
+	args.suite.options.min_reps = (std::min)(args.suite.options.min_reps, args.suite.options.max_reps);
+	args.sweep.model_path = args.suite.model_path;
+	args.sweep.filter = args.suite.filter;
+	args.scaling_config.model_path = args.suite.model_path;
+	args.scaling_config.filter = args.suite.filter;
+	args.scaling_config.content = args.sweep.content;
+	args.scaling_config.scale = args.sweep.scale;
+	return args;
+}
+
+static ResultRecord to_record(const BenchmarkResult& result) {
+	ResultRecord record;
+	record.set("kernel", result.label());
+	record.set("size", std::to_string(result.width) + "x" + std::to_string(result.height));
+	record.set("width", static_cast<double>(result.width));
+	record.set("height", static_cast<double>(result.height));
+	record.set("reps", static_cast<double>(result.reps));
+	record.set("min_ms", result.min_ms);
+	record.set("median_ms", result.median_ms);
+	record.set("p95_ms", result.p95_ms);
+	record.set("mp_per_s", result.mp_per_s());
+	record.set("samples_ms", result.samples_ms);
+	// Counter events and memory figures that were not measured are left out rather than written as -1
+	auto set_measured = [&](const std::string& field, double value) {
+		if (value >= 0.0) {
+			record.set(field, value);
+		}
+	};
+	set_measured("cycles", result.counters.cycles);
+	set_measured("instructions", result.counters.instructions);
+	set_measured("ipc", result.counters.ipc());
+	set_measured("llc_misses_per_mp", result.per_mp(result.counters.llc_misses));
+	set_measured("branch_misses_per_mp", result.per_mp(result.counters.branch_misses));
+	const long long working = result.memory.working_bytes();
+	set_measured("mb_per_mp", working >= 0 ? result.per_mp(working / BYTES_PER_MB) : -1.0);
+	set_measured("peak_rss_mb", result.memory.peak_rss_bytes >= 0 ? result.memory.peak_rss_bytes / BYTES_PER_MB : -1.0);
+	set_measured("threads", result.threads > 0 ? result.threads : -1.0);
+	set_measured("efficiency", result.efficiency);
+	return record;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkArgs args = parse_args(argc, argv);
+	if (!args.valid) {
+		return 1;
+	}
+	ThreadBudget::configure(args.threads);
+
+	for (const auto& size : KernelBenchmarks::standard_sizes()) {
+		args.suite.sizes.push_back(size);
+		if (size.label == args.max_size) {
+			break;
+		}
+	}
+
+	std::cout << "Kernel benchmarks - " << ThreadBudget::total() << " threads, SSIM kernels: "
+		<< ConvolutionSIMD::instruction_set() << ", warmup " << args.suite.options.warmup
+		<< ", " << args.suite.options.min_reps << "-" << args.suite.options.max_reps << " reps\n";
+	std::unique_ptr<PerfCounters> counters;
+	if (args.counters) {
+		counters = std::make_unique<PerfCounters>(ThreadBudget::per_job());
+		if (!counters->available()) {
+			std::cout << "Hardware counters unavailable: " << counters->status() << "; timing only\n";
+		}
+		else {
+			std::cout << "Hardware counters: cycles, instructions, LLC and branch misses on " << ThreadBudget::per_job() << " threads";
+			if (!counters->status().empty()) {
+				std::cout << " (" << counters->status() << ")";
+			}
+			std::cout << "; the SRCNN cases run on ONNX Runtime's and OpenCV's pools and show -\n";
+			args.suite.options.counters = counters.get();
+		}
+	}
+	std::cout << "\n";
+	args.sweep.options = args.suite.options;
+	args.scaling_config.options = args.suite.options;
+	if (args.scaling_config.threads.empty()) {
+		args.scaling_config.threads = ThreadScaling::default_threads(ThreadBudget::total());
+	}
+	std::vector<ResultRecord> records;
+	try {
+		std::vector<BenchmarkResult> results;
+		if (args.scaling) {
+			results = ThreadScaling::run(args.scaling_config);
+		}
+		else if (!args.sweep.megapixels.empty()) {
+			results = ResolutionSweep::run(args.sweep);
+		}
+		else {
+			results = KernelBenchmarks::run(args.suite);
+		}
+		for (const auto& result : results) {
+			records.push_back(to_record(result));
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Benchmark failed: " << e.what() << std::endl;
+		return 1;
+	}
+
+	if (!args.json_path.empty()) {
+		ResultIO::writeJson(args.json_path, "kernels", records);
+	}
+	if (!args.csv_path.empty()) {
+		ResultIO::writeCsv(args.csv_path, records);
+	}
+	if (!args.baseline_path.empty()) {
+		std::vector<ResultRecord> baseline;
+		if (!ResultIO::load(args.baseline_path, baseline)) {
+			return 1;
+		}
+		std::cout << "\nBaseline " << args.baseline_path << "\n";
+		if (Regression::report(Regression::compareKernels(baseline, records, args.thresholds), std::cout) > 0) {
+			return 3;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <iostream>
+#include "KernelBenchmarks.h"
+#include "SyntheticImage.h"
+#include "../core/Scaler.h"
+#include "../interpolation/Bilinear.h"
+#include "../interpolation/Bicubic.h"
+#include "../metrics/Metrics.h"
+#include "../metrics/ConvolutionSIMD.h"
+#include "../srcnn/SRCNNUpscaler.h"
+
+std::vector<BenchmarkSize> KernelBenchmarks::standard_sizes() {
+	return {
+		{ "256", 256, 256 },
+		{ "512", 512, 512 },
+		{ "1024", 1024, 1024 },
+		{ "1080p", 1920, 1080 },
+		{ "4k", 3840, 2160 },
+		{ "8k", 7680, 4320 }
+	};
+}
+
+std::vector<BenchmarkResult> KernelBenchmarks::run(const SuiteConfig& config) {
+	std::vector<BenchmarkResult> results;
+	Benchmark::print_header(counting(config));
+	for (const auto& size : config.sizes) {
+		interpolator_cases(config, size, results);
+		metric_cases(config, size, results);
+	}
+	srcnn_cases(config, results);
+	return results;
+}
+
+bool KernelBenchmarks::counting(const SuiteConfig& config) {
+	return config.options.counters && config.options.counters->available();
+}
+
+void KernelBenchmarks::run_case(const SuiteConfig& config, const std::string& name, const BenchmarkSize& size,
+	const std::function<void()>& body, std::vector<BenchmarkResult>& results, bool team_only)
+{
+	if (!Benchmark::selected(config.filter, name)) {
+		return;
+	}
+	BenchmarkOptions options = config.options;
+	if (!team_only) {
+		// Counting the calling thread alone would pass off a fraction of the work as all of it
+		options.counters = nullptr;
+	}
+	results.push_back(Benchmark::measure(name, size.width, size.height, options, body));
+	Benchmark::print_row(results.back(), counting(config));
+}
+
+// 2x upscale into the benchmark size; MP/s counts output pixels
+void KernelBenchmarks::interpolator_cases(const SuiteConfig& config, const BenchmarkSize& size, std::vector<BenchmarkResult>& results) {
+	if (!Benchmark::selected(config.filter, "bilinear") && !Benchmark::selected(config.filter, "bicubic")) {
+		return;
+	}
+	Image source = SyntheticImage::generate(size.width / 2, size.height / 2, SyntheticContent::Mixed, 1);
+	Bilinear bilinear;
+	Bicubic bicubic;
+	run_case(config, "bilinear", size, [&] {
+		Image out = Scaler::upscale(source, size.width, size.height, bilinear);
+		Benchmark::do_not_optimize(out.getData()[0].r);
+	}, results);
+	run_case(config, "bicubic", size, [&] {
+		Image out = Scaler::upscale(source, size.width, size.height, bicubic);
+		Benchmark::do_not_optimize(out.getData()[0].r);
+	}, results);
+}
+
+void KernelBenchmarks::metric_cases(const SuiteConfig& config, const BenchmarkSize& size, std::vector<BenchmarkResult>& results) {
+	const Image reference = SyntheticImage::generate(size.width, size.height, SyntheticContent::Mixed, 2);
+	const Image test = SyntheticImage::perturbed(reference, 3);
+	const ImageView ref = reference.view();
+	const ImageView tst = test.view();
+	const size_t plane_size = static_cast<size_t>(size.width) * size.height;
+
+	if (Benchmark::selected(config.filter, "luma")) {
+		std::vector<float> plane(plane_size);
+		run_case(config, "luma", size, [&] {
+			for (int y = 0; y < ref.height; y++) {
+				Metrics::load_channel(ref.row(y), ref.width, Metrics::Channel::Y, plane.data() + static_cast<size_t>(y) * ref.width);
+			}
+			Benchmark::do_not_optimize(plane[0]);
+		}, results);
+	}
+	if (Benchmark::selected(config.filter, "convolve")) {
+		const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+		std::vector<float> plane(plane_size), output(plane_size), temp(plane_size);
+		for (int y = 0; y < ref.height; y++) {
+			Metrics::load_channel(ref.row(y), ref.width, Metrics::Channel::Y, plane.data() + static_cast<size_t>(y) * ref.width);
+		}
+		run_case(config, "convolve", size, [&] {
+			Metrics::convolve_channel(plane.data(), output.data(), size.width, size.height, kernel1d, temp.data());
+			Benchmark::do_not_optimize(output[0]);
+		}, results);
+	}
+	run_case(config, "mse", size, [&] {
+		Benchmark::do_not_optimize(Metrics::calculateMSE(ref, tst));
+	}, results);
+	run_case(config, "ssim", size, [&] {
+		Benchmark::do_not_optimize(Metrics::calculateSSIM(ref, tst));
+	}, results);
+	run_case(config, "ssim-luma", size, [&] {
+		Benchmark::do_not_optimize(Metrics::calculateLumaSSIM(ref, tst));
+	}, results);
+}
+
+/**
+ * Splits SRCNNUpscaler::upscale into the three stages it runs: preprocess (bicubic upscale for
+ * pre-upsampling models, BGR to YCrCb, Y normalization), the network, and postprocess (clamping,
+ * chroma upscale for sub-pixel models, merging and converting back). Each case produces the
+ * benchmark size: sub-pixel models upscale by their own scale, pre-upsampling models by 2.
+ * The stages run on OpenCV's and ONNX Runtime's thread pools, so they are timed without counters.
+ */
+void KernelBenchmarks::srcnn_cases(const SuiteConfig& config, std::vector<BenchmarkResult>& results) {
+	if (!Benchmark::selected(config.filter, "srcnn")) {
+		return;
+	}
+	if (config.model_path.empty()) {
+		std::cout << "(srcnn cases skipped: no --model given)\n";
+		return;
+	}
+
+	SRCNNUpscaler srcnn(config.model_path);
+	const int scale = (std::max)(2, srcnn.get_model_scale());
+	for (const auto& size : config.sizes) {
+		const Image image = SyntheticImage::generate(size.width / scale, size.height / scale, SyntheticContent::Mixed, 4);
+		const cv::Size target_size(image.getWidth() * scale, image.getHeight() * scale);
+		run_case(config, "srcnn-pre", size, [&] {
+			SRCNNUpscaler::Planes planes = srcnn.preprocess(image, target_size);
+			Benchmark::do_not_optimize(planes.y_float.at<float>(0, 0));
+		}, results, false);
+
+		const SRCNNUpscaler::Planes planes = srcnn.preprocess(image, target_size);
+		run_case(config, "srcnn-inference", size, [&] {
+			cv::Mat out = srcnn.super_resolve_y(planes, nullptr);
+			Benchmark::do_not_optimize(out.at<float>(0, 0));
+		}, results, false);
+
+		const cv::Mat sr_y = srcnn.super_resolve_y(planes, nullptr);
+		run_case(config, "srcnn-post", size, [&] {
+			Image out = srcnn.postprocess(planes, sr_y, target_size);
+			Benchmark::do_not_optimize(out.getData()[0].r);
+		}, results, false);
+
+		if (size.label == config.srcnn_max_size) {
+			break;
+		}
+	}
+}
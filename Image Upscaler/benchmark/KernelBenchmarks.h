@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "../core/Image.h"
+
+struct BenchmarkSize {
+	std::string label;
+	int width;
+	int height;
+};
+
+struct SuiteConfig {
+	BenchmarkOptions options;
+	std::vector<BenchmarkSize> sizes;
+	// Largest size the SRCNN cases run at; network inference at 8K takes minutes per repetition
+	std::string srcnn_max_size = "1080p";
+	// ONNX model for the SRCNN cases; empty skips them
+	std::string model_path;
+	// Only cases whose name contains this run
+	std::string filter;
+};
+
+/**
+ * The kernel microbenchmark suite: both interpolators, the SSIM Gaussian convolution, MSE,
+ * full SSIM, the Y conversion and SRCNN inference with its pre/post processing, each on
+ * SyntheticImage inputs so the suite needs no data on disk. Declared a friend of Metrics and
+ * SRCNNUpscaler to time their private kernels in isolation.
+ */
+class KernelBenchmarks {
+public:
+	static std::vector<BenchmarkSize> standard_sizes();
+	static std::vector<BenchmarkResult> run(const SuiteConfig& config);
+
+private:
+	static bool counting(const SuiteConfig& config);
+	// team_only: the case's work runs on ThreadBudget's OpenMP team, the threads PerfCounters watches
+	static void run_case(const SuiteConfig& config, const std::string& name, const BenchmarkSize& size,
+		const std::function<void()>& body, std::vector<BenchmarkResult>& results, bool team_only = true);
+	static void interpolator_cases(const SuiteConfig& config, const BenchmarkSize& size, std::vector<BenchmarkResult>& results);
+	static void metric_cases(const SuiteConfig& config, const BenchmarkSize& size, std::vector<BenchmarkResult>& results);
+	static void srcnn_cases(const SuiteConfig& config, std::vector<BenchmarkResult>& results);
+};
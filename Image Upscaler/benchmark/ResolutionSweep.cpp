@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include "ResolutionSweep.h"
+#include "../core/Scaler.h"
+#include "../interpolation/Bilinear.h"
+#include "../interpolation/Bicubic.h"
+#include "../metrics/Metrics.h"
+#include "../srcnn/SRCNNUpscaler.h"
+
+BenchmarkSize ResolutionSweep::size_for(double megapixels, int scale) {
+	const int step = std::lcm(8, (std::max)(1, scale));
+	const double width = std::sqrt(megapixels * 1e6 * 4.0 / 3.0);
+	const int w = (std::max)(step, static_cast<int>(std::lround(width / step)) * step);
+	const int h = (std::max)(step, static_cast<int>(std::lround(width * 0.75 / step)) * step);
+	std::ostringstream label;
+	label << megapixels << "MP";
+	return { label.str(), w, h };
+}
+
+std::vector<BenchmarkResult> ResolutionSweep::run(const SweepConfig& config) {
+	std::unique_ptr<SRCNNUpscaler> srcnn;
+	if (Benchmark::selected(config.filter, "srcnn") && !config.model_path.empty()) {
+		srcnn = std::make_unique<SRCNNUpscaler>(config.model_path);
+	}
+
+	std::cout << "Resolution sweep - " << SyntheticImage::content_name(config.content) << " content, "
+		<< config.scale << "x upscales, output sizes in MP\n\n";
+	print_header();
+	std::vector<BenchmarkResult> results;
+	Bilinear bilinear;
+	Bicubic bicubic;
+	MetricOptions metric_options{ ColorSpace::Luma };
+	metric_options.border = config.scale;
+
+	for (double megapixels : config.megapixels) {
+		const BenchmarkSize size = size_for(megapixels, config.scale);
+		if (Benchmark::selected(config.filter, "bilinear") || Benchmark::selected(config.filter, "bicubic") || srcnn) {
+			Image source = SyntheticImage::generate(size.width / config.scale, size.height / config.scale, config.content, 1);
+			if (Benchmark::selected(config.filter, "bilinear")) {
+				run_case(config, "bilinear", size, [&] {
+					Image out = Scaler::upscale(source, size.width, size.height, bilinear);
+					Benchmark::do_not_optimize(out.getData()[0].r);
+				}, results);
+			}
+			if (Benchmark::selected(config.filter, "bicubic")) {
+				run_case(config, "bicubic", size, [&] {
+					Image out = Scaler::upscale(source, size.width, size.height, bicubic);
+					Benchmark::do_not_optimize(out.getData()[0].r);
+				}, results);
+			}
+			if (srcnn && megapixels <= config.srcnn_max_megapixels) {
+				run_case(config, "srcnn", size, [&] {
+					Image out = srcnn->upscale(source, config.scale);
+					Benchmark::do_not_optimize(out.getData()[0].r);
+				}, results);
+			}
+		}
+		if (Benchmark::selected(config.filter, "metrics")) {
+			const Image reference = SyntheticImage::generate(size.width, size.height, config.content, 2);
+			const Image test = SyntheticImage::perturbed(reference, 3);
+			run_case(config, "metrics", size, [&] {
+				Benchmark::do_not_optimize(Metrics::evaluate(reference.view(), test.view(), metric_options).ssim);
+			}, results);
+		}
+	}
+	print_scaling(results);
+	return results;
+}
+
+// The cold run starts from a trimmed heap, so its resident growth is the case's working memory
+// even in this target, which has no allocation hook
+void ResolutionSweep::run_case(const SweepConfig& config, const std::string& name, const BenchmarkSize& size,
+	const std::function<void()>& body, std::vector<BenchmarkResult>& results)
+{
+	MemoryStats::release_free_memory();
+	MemoryStats::Phase phase;
+	body();
+	const MemoryUsage memory = phase.finish();
+
+	BenchmarkOptions options = config.options;
+	options.warmup = (std::max)(0, options.warmup - 1);
+	results.push_back(Benchmark::measure(name, size.width, size.height, options, body));
+	results.back().memory = memory;
+	print_row(results.back());
+}
+
+void ResolutionSweep::print_header() {
+	std::cout << std::left
+		<< std::setw(10) << "Method"
+		<< std::setw(8) << "MP"
+		<< std::setw(12) << "Size"
+		<< std::right
+		<< std::setw(6) << "Reps"
+		<< std::setw(13) << "Median (ms)"
+		<< std::setw(10) << "MP/s"
+		<< std::setw(9) << "ns/px"
+		<< std::setw(9) << "MB/MP"
+		<< std::setw(12) << "Peak (MB)"
+		<< "\n" << std::string(89, '-') << "\n";
+}
+
+void ResolutionSweep::print_row(const BenchmarkResult& result) {
+	std::ios state(nullptr);
+	state.copyfmt(std::cout);
+	const long long working = result.memory.working_bytes();
+	std::cout << std::left << std::fixed << std::setprecision(1)
+		<< std::setw(10) << result.name
+		<< std::setw(8) << result.megapixels()
+		<< std::setw(12) << (std::to_string(result.width) + "x" + std::to_string(result.height))
+		<< std::right
+		<< std::setw(6) << result.reps
+		<< std::setw(13) << result.median_ms
+		<< std::setw(10) << result.mp_per_s()
+		<< std::setw(9) << result.median_ms * 1e6 / (static_cast<double>(result.width) * result.height)
+		<< std::setw(9);
+	if (working >= 0) {
+		std::cout << working / BYTES_PER_MB / result.megapixels();
+	}
+	else {
+		std::cout << "-";
+	}
+	std::cout << std::setw(12);
+	if (result.memory.peak_rss_bytes >= 0) {
+		std::cout << result.memory.peak_rss_bytes / BYTES_PER_MB;
+	}
+	else {
+		std::cout << "-";
+	}
+	std::cout << std::endl;
+	std::cout.copyfmt(state);
+}
+
+// Cost per pixel of every size relative to the method's smallest; 1.00 is linear scaling
+void ResolutionSweep::print_scaling(const std::vector<BenchmarkResult>& results) {
+	std::map<std::string, std::vector<const BenchmarkResult*>> methods;
+	for (const auto& result : results) {
+		methods[result.name].push_back(&result);
+	}
+	std::ios state(nullptr);
+	state.copyfmt(std::cout);
+	std::cout << "\nCost per pixel relative to the smallest size\n" << std::fixed;
+	for (const auto& [name, rows] : methods) {
+		const BenchmarkResult& base = *rows.front();
+		const double base_ns = base.median_ms / base.megapixels();
+		std::cout << "  " << std::left << std::setw(10) << name << std::right;
+		for (const BenchmarkResult* row : rows) {
+			std::cout << "  " << std::setprecision(1) << row->megapixels() << "MP: "
+				<< std::setprecision(2) << (base_ns > 0.0 ? (row->median_ms / row->megapixels()) / base_ns : 0.0);
+		}
+		std::cout << "\n";
+	}
+	std::cout.copyfmt(state);
+}
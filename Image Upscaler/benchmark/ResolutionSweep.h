@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "KernelBenchmarks.h"
+#include "SyntheticImage.h"
+
+struct SweepConfig {
+	BenchmarkOptions options;
+	std::vector<double> megapixels; // output sizes, about 4:3
+	SyntheticContent content = SyntheticContent::Mixed;
+	int scale = 2;
+	// SRCNN stops above this output size; inference at 200 MP takes many minutes per repetition
+	double srcnn_max_megapixels = 16.0;
+	// ONNX model for the srcnn method; empty skips it
+	std::string model_path;
+	// Only methods whose name contains this run
+	std::string filter;
+};
+
+/**
+ * End-to-end cost of each method against output resolution on synthetic inputs: bilinear,
+ * bicubic and SRCNN upscales by the configured scale, and the full metric pass (PSNR, SSIM)
+ * against a perturbed reference. Each case is run once cold to take its memory figures, which
+ * doubles as a warmup, then timed like the kernel suite. The closing table shows cost per pixel
+ * relative to the smallest size, where cache and bandwidth effects show up as growth above 1.
+ */
+class ResolutionSweep {
+public:
+	static std::vector<BenchmarkResult> run(const SweepConfig& config);
+	// Dimensions of an image of about megapixels, 4:3, both multiples of 8 and of scale, so an
+	// upscale by scale produces exactly this size
+	static BenchmarkSize size_for(double megapixels, int scale);
+
+private:
+	static void run_case(const SweepConfig& config, const std::string& name, const BenchmarkSize& size,
+		const std::function<void()>& body, std::vector<BenchmarkResult>& results);
+	static void print_header();
+	static void print_row(const BenchmarkResult& result);
+	static void print_scaling(const std::vector<BenchmarkResult>& results);
+};
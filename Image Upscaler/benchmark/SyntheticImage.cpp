@@ -0,0 +1,128 @@
+#include "SyntheticImage.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "../core/ThreadBudget.h"
+
+namespace {
+
+constexpr int MIXED_TILE = 256;
+constexpr int FLAT_BLOCK = 128;
+constexpr int GLYPH_WIDTH = 8; // 3x5 glyph cells of 2px plus spacing
+constexpr int LINE_HEIGHT = 14;
+
+uint32_t hash(uint32_t x, uint32_t y, uint32_t seed) {
+	uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u ^ seed * 0xcb1ab31fu;
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+unsigned char clamp_byte(double value) {
+	return static_cast<unsigned char>(std::clamp(static_cast<int>(value), 0, 255));
+}
+
+Pixel gradient(int x, int y, int width, int height) {
+	const double fx = static_cast<double>(x) / (std::max)(1, width - 1);
+	const double fy = static_cast<double>(y) / (std::max)(1, height - 1);
+	const double wave = 40.0 * std::sin(x * 0.05) * std::cos(y * 0.03);
+	return { clamp_byte(255.0 * fx + wave), clamp_byte(255.0 * fy + wave), clamp_byte(128.0 + 64.0 * (fx - fy) + wave) };
+}
+
+Pixel noise(int x, int y, unsigned seed) {
+	const uint32_t h = hash(x, y, seed);
+	auto channel = [h](int shift) { return static_cast<unsigned char>(64 + ((h >> shift) & 127)); };
+	return { channel(0), channel(8), channel(16) };
+}
+
+// Each glyph is a 3x5 grid of 2px cells picked from a hash of its position; one in eight is a space
+Pixel text(int x, int y, unsigned seed) {
+	constexpr Pixel PAPER = { 235, 232, 225 };
+	constexpr Pixel INK = { 30, 30, 40 };
+	const int gx = x % GLYPH_WIDTH, gy = y % LINE_HEIGHT;
+	if (gx >= 6 || gy < 2 || gy >= 12) {
+		return PAPER;
+	}
+	const uint32_t glyph = hash(x / GLYPH_WIDTH, y / LINE_HEIGHT, seed);
+	if ((glyph & 7) == 0) {
+		return PAPER;
+	}
+	const int bit = ((gy - 2) / 2) * 3 + gx / 2;
+	return (glyph >> (bit + 3)) & 1 ? INK : PAPER;
+}
+
+Pixel flat(int x, int y, unsigned seed) {
+	const uint32_t h = hash(x / FLAT_BLOCK, y / FLAT_BLOCK, seed);
+	return { static_cast<unsigned char>(h), static_cast<unsigned char>(h >> 8), static_cast<unsigned char>(h >> 16) };
+}
+
+Pixel sample(SyntheticContent content, int x, int y, int width, int height, unsigned seed) {
+	switch (content) {
+	case SyntheticContent::Gradient:
+		return gradient(x, y, width, height);
+	case SyntheticContent::Noise:
+		return noise(x, y, seed);
+	case SyntheticContent::Text:
+		return text(x, y, seed);
+	case SyntheticContent::Flat:
+		return flat(x, y, seed);
+	case SyntheticContent::Mixed:
+	default:
+		break;
+	}
+	const uint32_t tile = hash(x / MIXED_TILE, y / MIXED_TILE, seed ^ 0x5bd1e995u) % 4;
+	return sample(static_cast<SyntheticContent>(tile), x, y, width, height, seed);
+}
+
+}
+
+Image SyntheticImage::generate(int width, int height, SyntheticContent content, unsigned seed) {
+	Image image(width, height);
+	#pragma omp parallel for schedule(static) num_threads(ThreadBudget::per_job())
+	for (int y = 0; y < height; y++) {
+		Pixel* row = &image.at(0, y);
+		for (int x = 0; x < width; x++) {
+			row[x] = sample(content, x, y, width, height, seed);
+		}
+	}
+	return image;
+}
+
+Image SyntheticImage::perturbed(const Image& image, unsigned seed) {
+	Image result = image;
+	#pragma omp parallel for schedule(static) num_threads(ThreadBudget::per_job())
+	for (int y = 0; y < result.getHeight(); y++) {
+		Pixel* row = &result.at(0, y);
+		for (int x = 0; x < result.getWidth(); x++) {
+			const int delta = static_cast<int>(hash(x, y, seed) % 9) - 4;
+			Pixel& p = row[x];
+			p.r = static_cast<unsigned char>(std::clamp(p.r + delta, 0, 255));
+			p.g = static_cast<unsigned char>(std::clamp(p.g - delta, 0, 255));
+			p.b = static_cast<unsigned char>(std::clamp(p.b + delta / 2, 0, 255));
+		}
+	}
+	return result;
+}
+
+bool SyntheticImage::parse_content(const std::string& name, SyntheticContent& content) {
+	for (SyntheticContent candidate : { SyntheticContent::Gradient, SyntheticContent::Noise, SyntheticContent::Text, SyntheticContent::Flat, SyntheticContent::Mixed }) {
+		if (content_name(candidate) == name) {
+			content = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string SyntheticImage::content_name(SyntheticContent content) {
+	switch (content) {
+	case SyntheticContent::Gradient: return "gradient";
+	case SyntheticContent::Noise: return "noise";
+	case SyntheticContent::Text: return "text";
+	case SyntheticContent::Flat: return "flat";
+	default: return "mixed";
+	}
+}
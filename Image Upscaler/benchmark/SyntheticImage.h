@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include "../core/Image.h"
+
+enum class SyntheticContent {
+	Gradient, // smooth ramps under a low-frequency wave
+	Noise, // independent per-pixel noise around mid grey, the worst case for interpolation and SSIM
+	Text, // dark block glyphs on a light page: dense hard edges
+	Flat, // large constant-colour rectangles
+	Mixed // 256px tiles of the four above, so every resolution sees every kind of region
+};
+
+/**
+ * Deterministic test images at any resolution, for benchmarks that need more than the small
+ * JPEGs in data/. Every pixel is a hash of its coordinates and the seed, so an image is the same
+ * bytes whatever the thread count, and the rows are generated in parallel: 200 MP takes seconds.
+ * Feature sizes are in pixels rather than fractions of the image, so a larger image has more
+ * edges and regions, not blurrier ones.
+ */
+class SyntheticImage {
+public:
+	static Image generate(int width, int height, SyntheticContent content = SyntheticContent::Mixed, unsigned seed = 1);
+	// Copy with a small deterministic per-pixel error, standing in for an upscaled image
+	static Image perturbed(const Image& image, unsigned seed);
+
+	static bool parse_content(const std::string& name, SyntheticContent& content);
+	static std::string content_name(SyntheticContent content);
+};
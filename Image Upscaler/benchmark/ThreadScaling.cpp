@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include "ThreadScaling.h"
+#include "ResolutionSweep.h"
+#include "../core/Scaler.h"
+#include "../core/ThreadBudget.h"
+#include "../interpolation/Bilinear.h"
+#include "../interpolation/Bicubic.h"
+#include "../metrics/Metrics.h"
+#include "../srcnn/SRCNNUpscaler.h"
+
+std::vector<int> ThreadScaling::default_threads(int max_threads) {
+	std::vector<int> threads;
+	for (int t = 1; t < max_threads; t *= 2) {
+		threads.push_back(t);
+	}
+	threads.push_back((std::max)(1, max_threads));
+	return threads;
+}
+
+std::vector<BenchmarkResult> ThreadScaling::run(const ScalingConfig& config) {
+	const int configured_threads = ThreadBudget::total();
+	Bilinear bilinear;
+	Bicubic bicubic;
+	std::vector<BenchmarkResult> all;
+
+	for (const bool weak : { false, true }) {
+		if (weak ? !config.weak : !config.strong) {
+			continue;
+		}
+		const std::string mode = weak ? "weak" : "strong";
+		std::cout << "\n" << (weak ? "Weak" : "Strong") << " scaling - " << config.megapixels << " MP output"
+			<< (weak ? " per thread" : "") << ", " << SyntheticImage::content_name(config.content) << " content\n";
+		Benchmark::print_header();
+		std::vector<BenchmarkResult> results;
+
+		for (int threads : config.threads) {
+			ThreadBudget::configure(threads);
+			const BenchmarkSize size = ResolutionSweep::size_for(weak ? config.megapixels * threads : config.megapixels, config.scale);
+			// The counter groups were opened for one team size; these teams vary and SRCNN runs on ORT's pool
+			BenchmarkOptions options = config.options;
+			options.counters = nullptr;
+			auto run_case = [&](const std::string& method, const std::function<void()>& body) {
+				results.push_back(Benchmark::measure(method + "-" + mode, size.width, size.height, options, body));
+				results.back().threads = threads;
+				Benchmark::print_row(results.back());
+			};
+
+			Image source = SyntheticImage::generate(size.width / config.scale, size.height / config.scale, config.content, 1);
+			if (Benchmark::selected(config.filter, "bilinear")) {
+				run_case("bilinear", [&] {
+					Image out = Scaler::upscale(source, size.width, size.height, bilinear);
+					Benchmark::do_not_optimize(out.getData()[0].r);
+				});
+			}
+			if (Benchmark::selected(config.filter, "bicubic")) {
+				run_case("bicubic", [&] {
+					Image out = Scaler::upscale(source, size.width, size.height, bicubic);
+					Benchmark::do_not_optimize(out.getData()[0].r);
+				});
+			}
+			if (Benchmark::selected(config.filter, "srcnn") && !config.model_path.empty()) {
+				// A session per thread count: the shared global pool was sized when the runtime started
+				SRCNNOptions srcnn_options;
+				srcnn_options.intra_op_threads = threads;
+				SRCNNUpscaler srcnn(config.model_path, srcnn_options);
+				run_case("srcnn", [&] {
+					Image out = srcnn.upscale(source, config.scale);
+					Benchmark::do_not_optimize(out.getData()[0].r);
+				});
+			}
+			if (Benchmark::selected(config.filter, "ssim")) {
+				const Image reference = SyntheticImage::generate(size.width, size.height, config.content, 2);
+				const Image test = SyntheticImage::perturbed(reference, 3);
+				run_case("ssim", [&] {
+					Benchmark::do_not_optimize(Metrics::calculateSSIM(reference.view(), test.view()));
+				});
+			}
+		}
+		print_curves(mode, results);
+		all.insert(all.end(), results.begin(), results.end());
+	}
+
+	ThreadBudget::configure(configured_threads);
+	return all;
+}
+
+/**
+ * Against the first thread count t0 with time T0, at t threads taking T (p = t / t0):
+ * strong speedup S = T0 / T and efficiency S / p; weak efficiency T0 / T and scaled speedup
+ * p * T0 / T. Karp-Flatt serial fraction e = (1/S - 1/p) / (1 - 1/p). Fills each result's efficiency.
+ */
+void ThreadScaling::print_curves(const std::string& mode, std::vector<BenchmarkResult>& results) {
+	std::map<std::string, std::vector<BenchmarkResult*>> methods;
+	for (auto& result : results) {
+		methods[result.name].push_back(&result);
+	}
+	std::ios state(nullptr);
+	state.copyfmt(std::cout);
+	std::cout << "\n" << (mode == "weak" ? "Weak" : "Strong") << " scaling efficiency\n" << std::fixed;
+	for (const auto& [name, rows] : methods) {
+		const BenchmarkResult& base = *rows.front();
+		std::cout << "  " << name << "\n";
+		for (BenchmarkResult* row : rows) {
+			const double p = static_cast<double>(row->threads) / base.threads;
+			const double ratio = row->median_ms > 0.0 ? base.median_ms / row->median_ms : 0.0;
+			const double speedup = mode == "weak" ? p * ratio : ratio;
+			row->efficiency = speedup / p;
+			std::cout << "    " << std::setw(3) << row->threads << " threads"
+				<< "  speedup " << std::setprecision(2) << std::setw(6) << speedup
+				<< "  efficiency " << std::setw(5) << row->efficiency
+				<< "  " << std::left << std::setw(20) << std::string(static_cast<size_t>(std::clamp(row->efficiency, 0.0, 1.0) * 20.0 + 0.5), '#') << std::right;
+			if (p > 1.0 && speedup > 0.0) {
+				std::cout << "  serial fraction " << std::setprecision(3) << (1.0 / speedup - 1.0 / p) / (1.0 - 1.0 / p);
+			}
+			std::cout << "\n";
+		}
+	}
+	std::cout.copyfmt(state);
+}
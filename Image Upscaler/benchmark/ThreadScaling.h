@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "SyntheticImage.h"
+
+struct ScalingConfig {
+	BenchmarkOptions options;
+	std::vector<int> threads; // thread budgets to run, ascending; the first is the baseline
+	double megapixels = 4.0; // strong scaling output size; weak scaling gives each thread this much
+	SyntheticContent content = SyntheticContent::Mixed;
+	int scale = 2;
+	bool strong = true;
+	bool weak = true;
+	// ONNX model for the srcnn method; empty skips it
+	std::string model_path;
+	// Only methods whose name contains this run
+	std::string filter;
+};
+
+/**
+ * Runs bilinear, bicubic, SRCNN and SSIM under a thread budget of each configured size.
+ * Strong scaling keeps the output size fixed, so the ideal time falls as 1/threads; weak scaling
+ * grows the output with the thread count, so the ideal time stays flat. Each thread count sets
+ * ThreadBudget (OpenMP regions), OpenCV's pool and a private ORT intra-op pool for SRCNN.
+ *
+ * The closing curves give speedup and efficiency against the first thread count, and the
+ * Karp-Flatt serial fraction: the share of the work that behaves as if it ran on one thread,
+ * so a method with a serial loop shows a fraction that stays high as threads are added.
+ */
+class ThreadScaling {
+public:
+	static std::vector<BenchmarkResult> run(const ScalingConfig& config);
+	// 1, 2, 4 ... up to max_threads, which is always included
+	static std::vector<int> default_threads(int max_threads);
+
+private:
+	static void print_curves(const std::string& mode, std::vector<BenchmarkResult>& results);
+};
@@ -0,0 +1,40 @@
+// Replaces the global operator new/delete to count heap use for MemoryStats. Linked into the
+// upscaler executable only, so the kernel microbenchmarks time the allocator without the counters.
+// The array, nothrow and sized forms all forward to these two by default. Aligned forms are left
+// alone: nothing here allocates over-aligned types.
+
+#include <cstdlib>
+#include <new>
+#include "MemoryStats.h"
+#if defined(_WIN32)
+#include <malloc.h>
+#define HOOK_USABLE_SIZE _msize
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define HOOK_USABLE_SIZE malloc_size
+#else
+#include <malloc.h>
+#define HOOK_USABLE_SIZE malloc_usable_size
+#endif
+
+void* operator new(std::size_t size) {
+	void* block = std::malloc(size ? size : 1);
+	if (!block) {
+		throw std::bad_alloc();
+	}
+	MemoryStats::on_allocate(HOOK_USABLE_SIZE(block));
+	return block;
+}
+
+void operator delete(void* block) noexcept {
+	if (block) {
+		MemoryStats::on_free(HOOK_USABLE_SIZE(block));
+		std::free(block);
+	}
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+	operator delete(block);
+}
+
+static const bool hook_installed = MemoryStats::install_hook();
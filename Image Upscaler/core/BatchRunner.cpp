@@ -0,0 +1,118 @@
+#include "BatchRunner.h"
+#include "BoundedQueue.h"
+#include "Trace.h"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * A feeder thread pushes indices into a queue of jobs slots; it also waits until the index is
+ * within the commit window, so one slow item cannot let the rest of the batch run far ahead
+ * of what has been reported. Workers pop indices, run them and mark them done; the caller
+ * commits the done prefix in order.
+ */
+void BatchRunner::run(size_t count, int jobs, const std::function<void(size_t)>& work, const std::function<void(size_t)>& commit) {
+	if (jobs <= 1 || count <= 1) {
+		for (size_t i = 0; i < count; i++) {
+			work(i);
+			commit(i);
+		}
+		return;
+	}
+
+	const size_t workers = (std::min)(static_cast<size_t>(jobs), count);
+	const size_t window = workers * WINDOW_PER_JOB;
+	BoundedQueue<size_t> queue(workers);
+	std::vector<char> done(count, 0);
+	std::vector<std::exception_ptr> errors(count);
+	size_t committed = 0;
+	bool stopped = false;
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	std::thread feeder([&] {
+		for (size_t i = 0; i < count; i++) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return stopped || i < committed + window; });
+				if (stopped) {
+					break;
+				}
+			}
+			if (!queue.push(i)) {
+				break;
+			}
+		}
+		queue.close();
+	});
+
+	std::vector<std::thread> pool;
+	pool.reserve(workers);
+	for (size_t w = 0; w < workers; w++) {
+		pool.emplace_back([&, w] {
+			TRACE_THREAD_NAME("batch worker " + std::to_string(w + 1));
+			while (std::optional<size_t> item = queue.pop()) {
+				// Items already queued when the batch stopped are dropped, not run
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (stopped) {
+						break;
+					}
+				}
+				std::exception_ptr error;
+				try {
+					work(*item);
+				}
+				catch (...) {
+					error = std::current_exception();
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				errors[*item] = error;
+				done[*item] = 1;
+				changed.notify_all();
+			}
+		});
+	}
+
+	auto stop = [&] {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopped = true;
+		}
+		changed.notify_all();
+		queue.close();
+		feeder.join();
+		for (auto& thread : pool) {
+			thread.join();
+		}
+	};
+
+	try {
+		while (committed < count) {
+			std::exception_ptr error;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return done[committed] != 0; });
+				error = errors[committed];
+			}
+			if (error) {
+				std::rethrow_exception(error);
+			}
+			commit(committed);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				committed++;
+			}
+			changed.notify_all();
+		}
+	}
+	catch (...) {
+		stop();
+		throw;
+	}
+	stop();
+}
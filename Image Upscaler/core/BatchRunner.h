@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * Runs independent work items on a fixed set of worker threads fed through a bounded queue.
+ * Items may finish in any order, but commit() sees them strictly in index order on the calling
+ * thread, so anything it prints or collects matches a serial run item for item.
+ */
+class BatchRunner {
+public:
+	// work(i) runs on a worker for every i in [0, count); commit(i) runs on the caller once
+	// items 0..i are all done. With jobs <= 1 both run inline, one item after the other.
+	// An exception thrown by work(i) stops the batch and is rethrown when item i is committed.
+	static void run(size_t count, int jobs, const std::function<void(size_t)>& work, const std::function<void(size_t)>& commit);
+
+private:
+	// Items allowed past the queue but not yet committed, per worker
+	static constexpr size_t WINDOW_PER_JOB = 2;
+};
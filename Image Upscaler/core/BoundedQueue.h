@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+/**
+ * Multi-producer, multi-consumer FIFO with a fixed capacity. push() blocks while the queue is
+ * full, which is what keeps a fast producer from running arbitrarily far ahead of its consumers.
+ * After close(), pushes are refused and pop() drains what is left, then returns nothing.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+	// Returns false if the queue was closed before the item could be added
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [&] { return closed || items.size() < capacity; });
+		if (closed) {
+			return false;
+		}
+		items.push_back(std::move(item));
+		not_empty.notify_one();
+		return true;
+	}
+
+	// Blocks until an item is available; empty once the queue is closed and drained
+	std::optional<T> pop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [&] { return closed || !items.empty(); });
+		if (items.empty()) {
+			return std::nullopt;
+		}
+		T item = std::move(items.front());
+		items.pop_front();
+		not_full.notify_one();
+		return item;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_full.notify_all();
+		not_empty.notify_all();
+	}
+
+	size_t size() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return items.size();
+	}
+
+private:
+	const size_t capacity;
+	std::deque<T> items;
+	bool closed = false;
+	mutable std::mutex mutex;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+};
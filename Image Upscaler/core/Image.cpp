@@ -1,4 +1,5 @@
 #include "Image.h"
+#include "Trace.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "../includes/stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -13,6 +14,7 @@ Pixel& Image::at(int x, int y) {
 }
 
 bool Image::loadFromFile(const std::string& filename) {
+	TRACE_SCOPE("Image::decode");
 	unsigned char* imgData = stbi_load(filename.c_str(), &width, &height, &channels, 3);
 	if (!imgData)
 		return false;
@@ -28,6 +30,7 @@ bool Image::loadFromFile(const std::string& filename) {
 }
 
 bool Image::saveToFile(const std::string& filename) {
+	TRACE_SCOPE("Image::encode");
 	std::vector <unsigned char> rawData(width * height * 3);
 
 	for (int i = 0; i < width * height; ++i) {
@@ -60,6 +63,10 @@ const std::vector<Pixel>& Image::getData() const {
 	return data;
 }
 
+ImageView Image::view() const {
+	return { data.data(), width, height, width, isGrayScale() };
+}
+
 bool Image::isGrayScale() const {
 	return channels == 1;
 }
@@ -2,7 +2,7 @@
 
 #include <vector>
 #include <string>
-#include <windows.h>
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 
@@ -12,6 +12,23 @@ struct Pixel {
 	unsigned char b;
 };
 
+/**
+ * Non-owning read-only window into interleaved pixels. stride is the distance between
+ * rows in pixels, so a view can cover a crop or a band of a larger image without copying.
+ */
+struct ImageView {
+	const Pixel* pixels = nullptr;
+	int width = 0;
+	int height = 0;
+	int stride = 0;
+	bool grayscale = false;
+
+	const Pixel* row(int y) const { return pixels + static_cast<size_t>(y) * stride; }
+	ImageView crop(int x, int y, int w, int h) const {
+		return { row(y) + x, w, h, stride, grayscale };
+	}
+};
+
 class Image {	
 	private:
 		int width;
@@ -28,4 +45,5 @@ class Image {
 	int getWidth() const;
 	int getHeight() const;
 	const std::vector<Pixel>& getData() const;
+	ImageView view() const;
 };
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "MemoryStats.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+std::atomic<bool> MemoryStats::hook_installed{ false };
+std::atomic<long long> MemoryStats::allocation_count{ 0 };
+std::atomic<long long> MemoryStats::allocation_bytes{ 0 };
+std::atomic<long long> MemoryStats::live_bytes{ 0 };
+std::atomic<long long> MemoryStats::peak_live_bytes{ 0 };
+std::mutex MemoryStats::phase_mutex;
+int MemoryStats::open_phases = 0;
+bool MemoryStats::open_rss_peak_reset = false;
+
+namespace {
+
+#ifdef __linux__
+// A "Name:   1234 kB" line of /proc/self/status, in bytes
+long long proc_status_bytes(const char* field) {
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	const std::string prefix = std::string(field) + ":";
+	while (std::getline(status, line)) {
+		if (line.compare(0, prefix.size(), prefix) == 0) {
+			return std::atoll(line.c_str() + prefix.size()) * 1024;
+		}
+	}
+	return -1;
+}
+#endif
+
+}
+
+long long MemoryStats::current_rss_bytes() {
+#if defined(__linux__)
+	return proc_status_bytes("VmRSS");
+#elif defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? static_cast<long long>(counters.WorkingSetSize) : -1;
+#else
+	return -1;
+#endif
+}
+
+long long MemoryStats::peak_rss_bytes() {
+#if defined(__linux__)
+	return proc_status_bytes("VmHWM");
+#elif defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? static_cast<long long>(counters.PeakWorkingSetSize) : -1;
+#else
+	return -1;
+#endif
+}
+
+void MemoryStats::release_free_memory() {
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+}
+
+// Writing 5 to clear_refs resets VmHWM (Linux 4.0+); Windows has no equivalent for the working set peak
+bool MemoryStats::reset_peak_rss() {
+#ifdef __linux__
+	std::ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+	clear_refs.flush();
+	return static_cast<bool>(clear_refs);
+#else
+	return false;
+#endif
+}
+
+bool MemoryStats::install_hook() {
+	hook_installed = true;
+	return true;
+}
+
+void MemoryStats::on_allocate(size_t bytes) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(static_cast<long long>(bytes), std::memory_order_relaxed);
+	const long long live = live_bytes.fetch_add(static_cast<long long>(bytes), std::memory_order_relaxed) + static_cast<long long>(bytes);
+	long long peak = peak_live_bytes.load(std::memory_order_relaxed);
+	while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+	}
+}
+
+void MemoryStats::on_free(size_t bytes) {
+	live_bytes.fetch_sub(static_cast<long long>(bytes), std::memory_order_relaxed);
+}
+
+// The /proc reads allocate, so they sit outside the span the heap counters cover
+MemoryStats::Phase::Phase() {
+	std::lock_guard<std::mutex> lock(phase_mutex);
+	const bool first = open_phases++ == 0;
+	if (first) {
+		open_rss_peak_reset = reset_peak_rss();
+	}
+	rss_peak_reset = open_rss_peak_reset;
+	start_rss_bytes = current_rss_bytes();
+	start_allocations = allocation_count.load(std::memory_order_relaxed);
+	start_allocated_bytes = allocation_bytes.load(std::memory_order_relaxed);
+	start_live_bytes = live_bytes.load(std::memory_order_relaxed);
+	// Restart the high-water so finish() sees this phase's peak, not the process's; a phase that
+	// opens while others are still measuring leaves their peaks alone
+	if (first) {
+		peak_live_bytes.store(start_live_bytes, std::memory_order_relaxed);
+	}
+}
+
+MemoryStats::Phase::~Phase() {
+	close();
+}
+
+void MemoryStats::Phase::close() const {
+	std::lock_guard<std::mutex> lock(phase_mutex);
+	if (open) {
+		open = false;
+		open_phases--;
+	}
+}
+
+MemoryUsage MemoryStats::Phase::finish() const {
+	MemoryUsage usage;
+	if (hooked()) {
+		usage.allocations = allocation_count.load(std::memory_order_relaxed) - start_allocations;
+		usage.allocated_bytes = allocation_bytes.load(std::memory_order_relaxed) - start_allocated_bytes;
+		usage.peak_heap_bytes = (std::max)(0LL, peak_live_bytes.load(std::memory_order_relaxed) - start_live_bytes);
+	}
+	usage.peak_rss_bytes = peak_rss_bytes();
+	if (rss_peak_reset && start_rss_bytes >= 0 && usage.peak_rss_bytes >= 0) {
+		usage.rss_growth_bytes = (std::max)(0LL, usage.peak_rss_bytes - start_rss_bytes);
+	}
+	close();
+	return usage;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+constexpr double BYTES_PER_MB = 1024.0 * 1024.0;
+
+// Memory used by one phase of a run. Figures the platform cannot provide stay at -1.
+struct MemoryUsage {
+	long long allocations = -1; // operator new calls
+	long long allocated_bytes = -1; // bytes handed out by those calls
+	long long peak_heap_bytes = -1; // live heap high-water above the level at the start of the phase
+	long long peak_rss_bytes = -1; // resident set high-water of the process during the phase
+	long long rss_growth_bytes = -1; // how far that high-water rose above the resident set at the start
+
+	// Working memory of the phase: the heap high-water, or the resident growth where that is larger,
+	// since ONNX Runtime's arena allocates outside operator new
+	long long working_bytes() const { return (peak_heap_bytes > rss_growth_bytes) ? peak_heap_bytes : rss_growth_bytes; }
+};
+
+/**
+ * Process memory accounting. Allocation counts come from the operator new/delete replacement in
+ * AllocationHook.cpp, which only the upscaler executable links; without it hooked() is false and
+ * the allocation figures stay at -1. Resident set figures come from /proc/self/status on Linux
+ * and GetProcessMemoryInfo on Windows.
+ *
+ * The counters are process wide, so a Phase is attributable to one item only while no other
+ * phase runs. The high-water marks restart only when a phase opens with none open; a phase that
+ * overlaps others (--jobs, --pipeline) reports the peak since the oldest of them opened, which
+ * covers every item in flight and never erases another phase's peak.
+ */
+class MemoryStats {
+public:
+	static bool hooked() { return hook_installed.load(std::memory_order_relaxed); }
+	static long long current_rss_bytes();
+	static long long peak_rss_bytes();
+	// Returns freed heap pages to the OS (glibc only), so a following phase's resident growth
+	// reflects its own allocations rather than reuse of pages an earlier phase left behind
+	static void release_free_memory();
+
+	// From construction to finish(), or to destruction if finish() is never called
+	class Phase {
+	public:
+		Phase();
+		~Phase();
+		Phase(const Phase&) = delete;
+		Phase& operator=(const Phase&) = delete;
+		MemoryUsage finish() const;
+
+	private:
+		void close() const;
+
+		long long start_allocations;
+		long long start_allocated_bytes;
+		long long start_live_bytes;
+		long long start_rss_bytes;
+		bool rss_peak_reset;
+		mutable bool open = true;
+	};
+
+	// Called by the allocation hook
+	static bool install_hook();
+	static void on_allocate(size_t bytes);
+	static void on_free(size_t bytes);
+
+private:
+	static std::atomic<bool> hook_installed;
+	static std::atomic<long long> allocation_count;
+	static std::atomic<long long> allocation_bytes;
+	static std::atomic<long long> live_bytes;
+	static std::atomic<long long> peak_live_bytes;
+	// Phases between construction and finish(); the high-water marks restart when this leaves 0
+	static std::mutex phase_mutex;
+	static int open_phases;
+	static bool open_rss_peak_reset;
+
+	// Restarts the resident high-water at the current resident set; Linux only
+	static bool reset_peak_rss();
+};
@@ -0,0 +1,217 @@
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int EVENT_COUNT = 4;
+const char* const EVENT_NAMES[EVENT_COUNT] = { "cycles", "instructions", "LLC misses", "branch misses" };
+
+double* fields(CounterValues& values, int event) {
+	double* all[EVENT_COUNT] = { &values.cycles, &values.instructions, &values.llc_misses, &values.branch_misses };
+	return all[event];
+}
+
+// Any event missing on either side stays missing
+double difference(double a, double b) {
+	return a >= 0.0 && b >= 0.0 ? a - b : -1.0;
+}
+
+double sum(double a, double b) {
+	return a >= 0.0 && b >= 0.0 ? a + b : -1.0;
+}
+
+#ifdef __linux__
+std::string describe_error(int error) {
+	switch (error) {
+	case ENOENT:
+	case ENODEV:
+	case EOPNOTSUPP:
+		return "no hardware PMU exposed (VM or container)";
+	case EACCES:
+	case EPERM:
+		return "not permitted (kernel.perf_event_paranoid, CAP_PERFMON or a seccomp profile)";
+	case ENOSYS:
+		return "perf_event_open is not available in this kernel";
+	default:
+		return std::strerror(error);
+	}
+}
+#endif
+
+}
+
+CounterValues CounterValues::operator-(const CounterValues& other) const {
+	return { difference(cycles, other.cycles), difference(instructions, other.instructions),
+		difference(llc_misses, other.llc_misses), difference(branch_misses, other.branch_misses) };
+}
+
+CounterValues& CounterValues::operator+=(const CounterValues& other) {
+	cycles = sum(cycles, other.cycles);
+	instructions = sum(instructions, other.instructions);
+	llc_misses = sum(llc_misses, other.llc_misses);
+	branch_misses = sum(branch_misses, other.branch_misses);
+	return *this;
+}
+
+CounterValues CounterValues::operator/(double divisor) const {
+	auto divide = [divisor](double value) { return value >= 0.0 ? value / divisor : -1.0; };
+	return { divide(cycles), divide(instructions), divide(llc_misses), divide(branch_misses) };
+}
+
+/**
+ * One perf event group on one thread: cycles leads, so all events are scheduled together and a
+ * single read returns them. Events after the leader are optional.
+ */
+struct PerfCounters::Group {
+	int fds[EVENT_COUNT] = { -1, -1, -1, -1 };
+	int slot[EVENT_COUNT] = { -1, -1, -1, -1 }; // position in the group read, -1 when not opened
+	int opened = 0;
+
+	Group() = default;
+	Group(const Group&) = delete;
+	Group& operator=(const Group&) = delete;
+
+	~Group() {
+#ifdef __linux__
+		for (int fd : fds) {
+			if (fd >= 0) {
+				close(fd);
+			}
+		}
+#endif
+	}
+
+	bool open(std::string& error) {
+#ifdef __linux__
+		static const uint64_t CONFIGS[EVENT_COUNT] = {
+			PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+		};
+		for (int e = 0; e < EVENT_COUNT; e++) {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = CONFIGS[e];
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, e == 0 ? -1 : fds[0], PERF_FLAG_FD_CLOEXEC));
+			if (fd < 0) {
+				if (e == 0) {
+					error = describe_error(errno);
+					return false;
+				}
+				continue;
+			}
+			fds[e] = fd;
+			slot[e] = opened++;
+		}
+		return true;
+#else
+		error = "hardware counters need Linux perf_event_open";
+		return false;
+#endif
+	}
+
+	// Scales for multiplexing when more events are open than the PMU has counters
+	bool read(CounterValues& out) const {
+#ifdef __linux__
+		uint64_t data[3 + EVENT_COUNT];
+		const ssize_t expected = static_cast<ssize_t>((3 + opened) * sizeof(uint64_t));
+		if (fds[0] < 0 || ::read(fds[0], data, sizeof(data)) < expected || data[2] == 0) {
+			return false;
+		}
+		const double scale = data[2] < data[1] ? static_cast<double>(data[1]) / data[2] : 1.0;
+		out = CounterValues();
+		for (int e = 0; e < EVENT_COUNT; e++) {
+			if (slot[e] >= 0) {
+				*fields(out, e) = static_cast<double>(data[3 + slot[e]]) * scale;
+			}
+		}
+		return true;
+#else
+		(void)out;
+		return false;
+#endif
+	}
+};
+
+PerfCounters::PerfCounters(int threads) {
+	threads = (std::max)(1, threads);
+	std::vector<std::unique_ptr<Group>> opened(threads);
+	std::vector<std::string> errors(threads);
+	auto open_on = [&](int t) {
+		auto group = std::make_unique<Group>();
+		if (group->open(errors[t])) {
+			opened[t] = std::move(group);
+		}
+	};
+#ifdef _OPENMP
+	#pragma omp parallel num_threads(threads)
+	open_on(omp_get_thread_num());
+#else
+	threads = 1;
+	open_on(0);
+#endif
+
+	for (int t = 0; t < threads; t++) {
+		if (!opened[t]) {
+			// A partial team would undercount every parallel kernel; report nothing instead
+			message = errors[t].empty() ? "the OpenMP team had fewer threads than requested" : errors[t];
+			return;
+		}
+	}
+	for (int e = 0; e < EVENT_COUNT; e++) {
+		if (opened[0]->slot[e] < 0) {
+			message += (message.empty() ? "missing events: " : ", ") + std::string(EVENT_NAMES[e]);
+		}
+	}
+	groups = std::move(opened);
+}
+
+PerfCounters::~PerfCounters() = default;
+
+CounterValues PerfCounters::read() const {
+	CounterValues total;
+	for (size_t i = 0; i < groups.size(); i++) {
+		CounterValues values;
+		if (!groups[i]->read(values)) {
+			return CounterValues();
+		}
+		if (i == 0) {
+			total = values;
+		}
+		else {
+			total += values;
+		}
+	}
+	return total;
+}
+
+bool PerfCounters::read_thread(CounterValues& out) {
+	thread_local std::unique_ptr<Group> group = [] {
+		auto created = std::make_unique<Group>();
+		std::string unused;
+		if (!created->open(unused)) {
+			created.reset();
+		}
+		return created;
+	}();
+	return group && group->read(out);
+}
+
+bool PerfCounters::supported(std::string& reason) {
+	Group group;
+	return group.open(reason);
+}
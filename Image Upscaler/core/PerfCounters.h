@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Hardware event totals. An event the CPU or kernel would not open stays at -1, so a run in a
+ * VM without LLC events still reports cycles and IPC.
+ */
+struct CounterValues {
+	double cycles = -1.0;
+	double instructions = -1.0;
+	double llc_misses = -1.0;
+	double branch_misses = -1.0;
+
+	bool valid() const { return cycles >= 0.0; }
+	double ipc() const { return cycles > 0.0 && instructions >= 0.0 ? instructions / cycles : -1.0; }
+	CounterValues operator-(const CounterValues& other) const;
+	CounterValues& operator+=(const CounterValues& other);
+	CounterValues operator/(double divisor) const;
+};
+
+/**
+ * Linux perf_event_open counters (cycles, instructions, LLC misses, branch misses), counting
+ * user space only so the default perf_event_paranoid level allows them.
+ * The kernel counts per thread, so the constructor opens one group on each thread of an OpenMP
+ * team of the given size; the calling thread is member 0, and the runtime keeps the same
+ * workers for later parallel regions of that size. read() sums the groups. Threads outside that
+ * team, such as ONNX Runtime's intra-op pool and OpenCV's pool, are not counted.
+ * Nothing throws: where counters cannot be opened (containers, VMs without a virtual PMU,
+ * other platforms) available() is false and status() says why.
+ */
+class PerfCounters {
+public:
+	explicit PerfCounters(int threads = 1);
+	~PerfCounters();
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool available() const { return !groups.empty(); }
+	// Why counters are unavailable, or which events are missing; empty when all opened
+	const std::string& status() const { return message; }
+	CounterValues read() const;
+
+	// Counters of the calling thread alone, opened on first use; used by the trace scopes
+	static bool read_thread(CounterValues& out);
+	// Opens and closes a group on the calling thread; reason is set when that fails
+	static bool supported(std::string& reason);
+
+private:
+	struct Group;
+
+	std::vector<std::unique_ptr<Group>> groups;
+	std::string message;
+};
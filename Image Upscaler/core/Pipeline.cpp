@@ -0,0 +1,141 @@
+#include "Pipeline.h"
+#include "BoundedQueue.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+Pipeline::Pipeline(size_t queue_capacity) : queue_capacity((std::max)(static_cast<size_t>(1), queue_capacity)) {}
+
+void Pipeline::add_stage(const std::string& name, int workers, StageFn fn) {
+	stages.push_back({ name, (std::max)(1, workers), std::move(fn) });
+}
+
+/**
+ * Every stage pops item indices from its own input queue and pushes them into the next one;
+ * the last stage marks them done for the committing caller. A stage's output queue is closed
+ * once all of its workers have exited, which lets shutdown ripple down the chain. In flight are
+ * at most the items sitting in the queues plus one per worker.
+ */
+std::vector<StageStats> Pipeline::run(size_t count, const std::function<void(size_t)>& commit) {
+	using clock = std::chrono::steady_clock;
+	std::vector<StageStats> stats(stages.size());
+	if (stages.empty()) {
+		for (size_t i = 0; i < count; i++) {
+			commit(i);
+		}
+		return stats;
+	}
+
+	std::vector<std::unique_ptr<BoundedQueue<size_t>>> queues;
+	for (size_t s = 0; s < stages.size(); s++) {
+		queues.push_back(std::make_unique<BoundedQueue<size_t>>(queue_capacity));
+		stats[s].name = stages[s].name;
+		stats[s].workers = stages[s].workers;
+	}
+	std::vector<std::exception_ptr> errors(count);
+	std::vector<char> done(count, 0);
+	std::vector<int> running_workers(stages.size());
+	std::atomic<bool> stopped{ false };
+	std::mutex mutex;
+	std::condition_variable changed;
+	const clock::time_point start = clock::now();
+
+	std::thread feeder([&] {
+		for (size_t i = 0; i < count && !stopped; i++) {
+			if (!queues[0]->push(i)) {
+				break;
+			}
+		}
+		queues[0]->close();
+	});
+
+	std::vector<std::thread> pool;
+	for (size_t s = 0; s < stages.size(); s++) {
+		running_workers[s] = stages[s].workers;
+		for (int w = 0; w < stages[s].workers; w++) {
+			pool.emplace_back([&, s, w] {
+				TRACE_THREAD_NAME(stages[s].name + " " + std::to_string(w + 1));
+				const bool last = s + 1 == stages.size();
+				double busy_ms = 0.0, blocked_ms = 0.0;
+				size_t items = 0;
+				while (std::optional<size_t> item = queues[s]->pop()) {
+					const size_t i = *item;
+					// errors[i] was written upstream before the item was queued to this stage
+					if (!errors[i] && !stopped) {
+						clock::time_point begin = clock::now();
+						try {
+							stages[s].fn(i);
+						}
+						catch (...) {
+							errors[i] = std::current_exception();
+						}
+						busy_ms += std::chrono::duration<double, std::milli>(clock::now() - begin).count();
+						items++;
+					}
+					if (last) {
+						std::lock_guard<std::mutex> lock(mutex);
+						done[i] = 1;
+						changed.notify_all();
+						continue;
+					}
+					clock::time_point begin = clock::now();
+					bool pushed = queues[s + 1]->push(i);
+					blocked_ms += std::chrono::duration<double, std::milli>(clock::now() - begin).count();
+					if (!pushed) {
+						break;
+					}
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				stats[s].busy_ms += busy_ms;
+				stats[s].blocked_ms += blocked_ms;
+				stats[s].items += items;
+				if (--running_workers[s] == 0 && !last) {
+					queues[s + 1]->close();
+				}
+			});
+		}
+	}
+
+	auto stop = [&] {
+		stopped = true;
+		for (auto& queue : queues) {
+			queue->close();
+		}
+		feeder.join();
+		for (auto& thread : pool) {
+			thread.join();
+		}
+	};
+
+	try {
+		for (size_t committed = 0; committed < count; committed++) {
+			std::exception_ptr error;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return done[committed] != 0; });
+				error = errors[committed];
+			}
+			if (error) {
+				std::rethrow_exception(error);
+			}
+			commit(committed);
+		}
+	}
+	catch (...) {
+		stop();
+		throw;
+	}
+	stop();
+
+	const double wall_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	for (auto& stage : stats) {
+		stage.wall_ms = wall_ms;
+	}
+	return stats;
+}
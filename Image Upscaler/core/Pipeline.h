@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// How one pipeline stage spent the run. Utilization is busy time over the stage's
+// worker-seconds; blocked time is spent waiting for room in the next stage's queue.
+struct StageStats {
+	std::string name;
+	int workers = 0;
+	size_t items = 0;
+	double busy_ms = 0.0;
+	double blocked_ms = 0.0;
+	double wall_ms = 0.0;
+	double utilization() const { return wall_ms > 0.0 ? busy_ms / (wall_ms * workers) : 0.0; }
+};
+
+/**
+ * Moves indexed work items through a chain of stages, each with its own worker threads, joined
+ * by bounded queues. A full queue stalls the stage feeding it, so at most a fixed number of items
+ * are in flight no matter how uneven the stages are. Items are committed on the calling thread
+ * in index order, as in BatchRunner.
+ */
+class Pipeline {
+public:
+	using StageFn = std::function<void(size_t)>;
+
+	explicit Pipeline(size_t queue_capacity = 2);
+
+	void add_stage(const std::string& name, int workers, StageFn fn);
+	// Runs every stage on every i in [0, count), then commit(i) in index order. An exception from
+	// a stage skips the item's later stages, stops the run and is rethrown when i is committed.
+	std::vector<StageStats> run(size_t count, const std::function<void(size_t)>& commit);
+
+private:
+	struct Stage {
+		std::string name;
+		int workers;
+		StageFn fn;
+	};
+
+	size_t queue_capacity;
+	std::vector<Stage> stages;
+};
@@ -0,0 +1,27 @@
+#include "RowSource.h"
+#include "Scaler.h"
+#include <algorithm>
+#include <stdexcept>
+
+ImageRowSource::ImageRowSource(const ImageView& view) : source(view) {}
+
+void ImageRowSource::read_rows(Pixel* out, int count) {
+	if (next_row + count > source.height) {
+		throw std::runtime_error("ImageRowSource: read past the last row");
+	}
+	for (int i = 0; i < count; i++) {
+		std::copy_n(source.row(next_row + i), source.width, out + static_cast<size_t>(i) * source.width);
+	}
+	next_row += count;
+}
+
+ScalerRowSource::ScalerRowSource(Image& src, int width, int height, IInterpolator& interpolator)
+	: source(src), interpolator(interpolator), target_width(width), target_height(height) {}
+
+void ScalerRowSource::read_rows(Pixel* out, int count) {
+	if (next_row + count > target_height) {
+		throw std::runtime_error("ScalerRowSource: read past the last row");
+	}
+	Scaler::upscale_rows(source, target_width, target_height, interpolator, next_row, next_row + count, out);
+	next_row += count;
+}
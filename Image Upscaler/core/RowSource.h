@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Image.h"
+#include "../interpolation/IInterpolator.h"
+
+/**
+ * Sequential producer of image rows, top to bottom. Consumers that only need a few rows at a
+ * time (streaming metrics) read through this so neither image has to be held in memory whole.
+ */
+class IRowSource {
+public:
+	virtual ~IRowSource() = default;
+	virtual int width() const = 0;
+	virtual int height() const = 0;
+	virtual bool grayscale() const = 0;
+	// Writes the next count rows to out, width() pixels per row, rows back to back
+	virtual void read_rows(Pixel* out, int count) = 0;
+};
+
+// Rows of an image that is already in memory
+class ImageRowSource : public IRowSource {
+public:
+	explicit ImageRowSource(const ImageView& view);
+
+	int width() const override { return source.width; }
+	int height() const override { return source.height; }
+	bool grayscale() const override { return source.grayscale; }
+	void read_rows(Pixel* out, int count) override;
+
+private:
+	ImageView source;
+	int next_row = 0;
+};
+
+// Rows of Scaler::upscale(src, width, height, interpolator), produced on demand
+class ScalerRowSource : public IRowSource {
+public:
+	ScalerRowSource(Image& src, int width, int height, IInterpolator& interpolator);
+
+	int width() const override { return target_width; }
+	int height() const override { return target_height; }
+	bool grayscale() const override { return false; }
+	void read_rows(Pixel* out, int count) override;
+
+private:
+	Image& source;
+	IInterpolator& interpolator;
+	int target_width;
+	int target_height;
+	int next_row = 0;
+};
@@ -1,17 +1,25 @@
 #include "Scaler.h"
+#include "Trace.h"
 
 Image Scaler::upscale(Image& src, int nw, int nh, IInterpolator& it) {
+	TRACE_SCOPE("Scaler::upscale");
 	Image dst(nw, nh);
-	
+	if (nw > 0 && nh > 0) {
+		upscale_rows(src, nw, nh, it, 0, nh, &dst.at(0, 0));
+	}
+	return dst;
+}
+
+void Scaler::upscale_rows(Image& src, int nw, int nh, IInterpolator& it, int y_begin, int y_end, Pixel* out) {
 	float xr = static_cast<float>(src.getWidth()) / nw;
 	float yr = static_cast<float>(src.getHeight()) / nh;
 
-	for (int y = 0; y < nh; ++y) {
+	for (int y = y_begin; y < y_end; ++y) {
+		Pixel* row = out + static_cast<size_t>(y - y_begin) * nw;
 		for (int x = 0; x < nw; ++x) {
 			float sx = x * xr;
 			float sy = y * yr;
-			dst.at(x, y) = it.interpolate(src, sx, sy);
+			row[x] = it.interpolate(src, sx, sy);
 		}
 	}
-	return dst;
 }
\ No newline at end of file
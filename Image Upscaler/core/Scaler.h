@@ -6,4 +6,6 @@
 class Scaler {
 public:
 	static Image upscale(Image& src, int nw, int nh, IInterpolator& it);
+	// Rows [y_begin, y_end) of upscale(src, nw, nh, it), written back to back into out
+	static void upscale_rows(Image& src, int nw, int nh, IInterpolator& it, int y_begin, int y_end, Pixel* out);
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+#include "Statistics.h"
+#include <algorithm>
+#include <cmath>
+
+double Statistics::percentile(std::vector<double> values, double p) {
+	if (values.empty()) {
+		return 0.0;
+	}
+	std::sort(values.begin(), values.end());
+	size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+	return values[(std::max)(rank, size_t(1)) - 1];
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * Summary statistics over timing samples, shared by the SRCNN bucket latencies and the kernel
+ * microbenchmarks so both report the same percentiles.
+ */
+class Statistics {
+public:
+	// Nearest-rank percentile for p in [0, 1]; 0 when there are no values
+	static double percentile(std::vector<double> values, double p);
+};
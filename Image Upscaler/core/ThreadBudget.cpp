@@ -0,0 +1,29 @@
+#include <algorithm>
+#include <thread>
+#include <opencv2/core.hpp>
+#include "ThreadBudget.h"
+
+std::atomic<int> ThreadBudget::total_threads{ static_cast<int>((std::max)(1u, std::thread::hardware_concurrency())) };
+std::atomic<int> ThreadBudget::jobs{ 1 };
+
+void ThreadBudget::configure(int threads, int concurrent) {
+	if (threads <= 0) {
+		threads = static_cast<int>((std::max)(1u, std::thread::hardware_concurrency()));
+	}
+	total_threads = threads;
+	jobs = (std::max)(1, concurrent);
+	// cv::resize and cv::cvtColor run inside a single job, like the Metrics OpenMP regions
+	cv::setNumThreads(per_job());
+}
+
+int ThreadBudget::total() {
+	return total_threads;
+}
+
+int ThreadBudget::concurrent_jobs() {
+	return jobs;
+}
+
+int ThreadBudget::per_job() {
+	return (std::max)(1, total_threads / jobs);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Process wide thread budget shared by ONNX Runtime, OpenCV and the OpenMP regions in Metrics.
+ * total() threads are available to the process. When concurrent_jobs() images are processed
+ * at once, each job's own parallel sections get per_job() threads so the sum stays within total().
+ */
+class ThreadBudget {
+public:
+	// Also sizes OpenCV's pool to per_job(); ONNX Runtime reads the budget when it is first used
+	static void configure(int threads, int concurrent = 1);
+	static int total();
+	static int concurrent_jobs();
+	static int per_job();
+private:
+	static std::atomic<int> total_threads;
+	static std::atomic<int> jobs;
+};
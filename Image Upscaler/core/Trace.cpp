@@ -0,0 +1,161 @@
+#include "Trace.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::active{ false };
+std::atomic<bool> Trace::counting{ false };
+
+namespace {
+
+struct TraceEvent {
+	const char* name;
+	int64_t begin_ns;
+	int64_t end_ns;
+	CounterValues counters; // deltas over the scope; invalid when not counted
+};
+
+// Written only by its own thread; the registry keeps it alive after the thread exits
+struct ThreadBuffer {
+	int tid = 0;
+	std::string name;
+	std::vector<TraceEvent> events;
+};
+
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+	int64_t origin_ns = 0;
+};
+
+Registry& registry() {
+	static Registry instance;
+	return instance;
+}
+
+ThreadBuffer& local_buffer() {
+	thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+		auto created = std::make_shared<ThreadBuffer>();
+		created->events.reserve(4096);
+		Registry& reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		created->tid = static_cast<int>(reg.buffers.size()) + 1;
+		created->name = "thread " + std::to_string(created->tid);
+		reg.buffers.push_back(created);
+		return created;
+	}();
+	return *buffer;
+}
+
+std::string json_string(const std::string& value) {
+	std::string result = "\"";
+	for (char c : value) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+		}
+		result += c;
+	}
+	return result + "\"";
+}
+
+std::string counter_args(const CounterValues& counters) {
+	struct Field {
+		const char* name;
+		const char* format;
+		double value;
+	};
+	const Field fields[] = {
+		{ "cycles", "%.0f", counters.cycles },
+		{ "instructions", "%.0f", counters.instructions },
+		{ "ipc", "%.3f", counters.ipc() },
+		{ "llc_misses", "%.0f", counters.llc_misses },
+		{ "branch_misses", "%.0f", counters.branch_misses }
+	};
+	std::string result;
+	char value[64];
+	for (const auto& field : fields) {
+		if (field.value < 0.0) {
+			continue;
+		}
+		std::snprintf(value, sizeof(value), field.format, field.value);
+		result += (result.empty() ? "{\"" : ", \"") + std::string(field.name) + "\": " + value;
+	}
+	return result + "}";
+}
+
+}
+
+void Trace::start(bool counters) {
+	Registry& reg = registry();
+	{
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		if (reg.origin_ns == 0) {
+			reg.origin_ns = now_ns();
+		}
+	}
+	counting = counters;
+	active = true;
+}
+
+void Trace::stop() {
+	active = false;
+}
+
+void Trace::set_thread_name(const std::string& name) {
+	ThreadBuffer& buffer = local_buffer();
+	std::lock_guard<std::mutex> lock(registry().mutex);
+	buffer.name = name;
+}
+
+void Trace::record(const char* name, int64_t begin_ns, int64_t end_ns, const CounterValues& start_counters) {
+	CounterValues delta;
+	if (start_counters.valid() && PerfCounters::read_thread(delta)) {
+		delta = delta - start_counters;
+	}
+	else {
+		delta = CounterValues();
+	}
+	local_buffer().events.push_back({ name, begin_ns, end_ns, delta });
+}
+
+/**
+ * Complete ("X") events with microsecond timestamps relative to start(), one tid per thread,
+ * plus thread_name metadata so the viewer labels every row. Counted events carry their hardware
+ * counter deltas as args, shown when an event is selected; missing events are left out.
+ */
+bool Trace::writeChromeTrace(const std::string& path) {
+	stop();
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Error: Cannot write trace to " << path << std::endl;
+		return false;
+	}
+
+	Registry& reg = registry();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	size_t events = 0;
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	bool first = true;
+	char buffer[256];
+	for (const auto& thread : reg.buffers) {
+		out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread->tid
+			<< ", \"args\": {\"name\": " << json_string(thread->name) << "}}";
+		first = false;
+		for (const auto& event : thread->events) {
+			std::snprintf(buffer, sizeof(buffer), "\"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+				thread->tid, (event.begin_ns - reg.origin_ns) / 1000.0, (event.end_ns - event.begin_ns) / 1000.0);
+			out << ",\n{\"name\": " << json_string(event.name) << ", " << buffer;
+			if (event.counters.valid()) {
+				out << ", \"args\": " << counter_args(event.counters);
+			}
+			out << "}";
+		}
+		events += thread->events.size();
+	}
+	out << "\n]}\n";
+	std::cout << "Trace: " << events << " events on " << reg.buffers.size() << " threads written to " << path << std::endl;
+	return static_cast<bool>(out);
+}
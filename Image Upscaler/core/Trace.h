@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "PerfCounters.h"
+
+/**
+ * Scoped-timer instrumentation for per-thread timelines of a run.
+ * TRACE_SCOPE("name") records the enclosing scope as one complete event in a buffer owned by
+ * the calling thread, so probes never contend on a lock. writeChromeTrace() exports every
+ * thread's events as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev open.
+ *
+ * Probes only exist when UPSCALER_TRACE is defined (CMake option UPSCALER_TRACING); otherwise
+ * the macros expand to nothing. When compiled in, they cost one relaxed load until start().
+ * start(true) also attaches the thread's hardware counter deltas to every event, at the cost
+ * of two counter reads per scope; threads whose counters cannot be opened record time only.
+ * Event names must be string literals: only the pointer is stored.
+ */
+class Trace {
+public:
+	static void start(bool counters = false);
+	static void stop();
+	static bool enabled() { return active.load(std::memory_order_relaxed); }
+	// Names the calling thread's row in the trace viewer
+	static void set_thread_name(const std::string& name);
+	// Call once traced work has finished; events recorded while writing are not exported
+	static bool writeChromeTrace(const std::string& path);
+
+	class Scope {
+	public:
+		explicit Scope(const char* name) : name(enabled() ? name : nullptr) {
+			if (this->name) {
+				if (counting.load(std::memory_order_relaxed)) {
+					PerfCounters::read_thread(counters);
+				}
+				begin = now_ns();
+			}
+		}
+		~Scope() {
+			if (name) {
+				record(name, begin, now_ns(), counters);
+			}
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* name;
+		int64_t begin = 0;
+		CounterValues counters;
+	};
+
+private:
+	static std::atomic<bool> active;
+	static std::atomic<bool> counting;
+
+	static int64_t now_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	// start_counters is invalid unless the scope read counters when it opened
+	static void record(const char* name, int64_t begin_ns, int64_t end_ns, const CounterValues& start_counters);
+};
+
+#ifdef UPSCALER_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Trace::set_thread_name(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
@@ -1,4 +1,5 @@
 ﻿#include "Bicubic.h"
+#include <cmath>
 
 /**
  * Given a position (x, y) in the source image, this function computes the interpolated pixel value using bicubic interpolation.
@@ -1,10 +1,12 @@
 #include "Bilinear.h"
+#include <algorithm>
+#include <cmath>
 
 Pixel Bilinear::interpolate(Image& img, float x, float y) {
-	int x1 = static_cast<int>(floor(x));
-	int y1 = static_cast<int>(floor(y));
-	int x2 = min(x1 + 1, img.getWidth() - 1);
-	int y2 = min(y1 + 1, img.getHeight() - 1);
+	int x1 = static_cast<int>(std::floor(x));
+	int y1 = static_cast<int>(std::floor(y));
+	int x2 = (std::min)(x1 + 1, img.getWidth() - 1);
+	int y2 = (std::min)(y1 + 1, img.getHeight() - 1);
 	float dx = x - x1;
 	float dy = y - y1;
 
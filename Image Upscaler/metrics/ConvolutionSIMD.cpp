@@ -0,0 +1,158 @@
+#include <algorithm>
+#include "ConvolutionSIMD.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CONVOLUTION_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+constexpr int TAPS = ConvolutionSIMD::TAPS;
+constexpr int HALF = ConvolutionSIMD::HALF;
+constexpr const float* W = ConvolutionSIMD::WEIGHTS;
+
+static void horizontal_scalar(const float* input, float* output, int begin, int end) {
+	for (int x = begin; x < end; x++) {
+		float acc = 0.0f;
+		const float* base = input + x - HALF;
+		for (int k = 0; k < TAPS; k++) {
+			acc += W[k] * base[k];
+		}
+		output[x] = acc;
+	}
+}
+
+static void vertical_scalar(const float* const* rows, float* output, int begin, int end) {
+	for (int x = begin; x < end; x++) {
+		float acc = 0.0f;
+		for (int k = 0; k < TAPS; k++) {
+			acc += W[k] * rows[k][x];
+		}
+		output[x] = acc;
+	}
+}
+
+#ifdef CONVOLUTION_X86
+TARGET_AVX2 static void horizontal_avx2(const float* input, float* output, int begin, int end) {
+	int x = begin;
+	for (; x + 8 <= end; x += 8) {
+		const float* base = input + x - HALF;
+		__m256 acc = _mm256_setzero_ps();
+		for (int k = 0; k < TAPS; k++) {
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(W[k]), _mm256_loadu_ps(base + k)));
+		}
+		_mm256_storeu_ps(output + x, acc);
+	}
+	horizontal_scalar(input, output, x, end);
+}
+
+TARGET_AVX2 static void vertical_avx2(const float* const* rows, float* output, int width) {
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		__m256 acc = _mm256_setzero_ps();
+		for (int k = 0; k < TAPS; k++) {
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(W[k]), _mm256_loadu_ps(rows[k] + x)));
+		}
+		_mm256_storeu_ps(output + x, acc);
+	}
+	vertical_scalar(rows, output, x, width);
+}
+
+TARGET_AVX512 static void horizontal_avx512(const float* input, float* output, int begin, int end) {
+	int x = begin;
+	for (; x + 16 <= end; x += 16) {
+		const float* base = input + x - HALF;
+		__m512 acc = _mm512_setzero_ps();
+		for (int k = 0; k < TAPS; k++) {
+			acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_set1_ps(W[k]), _mm512_loadu_ps(base + k)));
+		}
+		_mm512_storeu_ps(output + x, acc);
+	}
+	horizontal_scalar(input, output, x, end);
+}
+
+TARGET_AVX512 static void vertical_avx512(const float* const* rows, float* output, int width) {
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m512 acc = _mm512_setzero_ps();
+		for (int k = 0; k < TAPS; k++) {
+			acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_set1_ps(W[k]), _mm512_loadu_ps(rows[k] + x)));
+		}
+		_mm512_storeu_ps(output + x, acc);
+	}
+	vertical_scalar(rows, output, x, width);
+}
+
+/**
+ * CPUID feature bits plus XGETBV, so instruction sets the OS does not save state for are never used.
+ */
+static bool cpu_supports(bool avx512) {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!osxsave) {
+		return false;
+	}
+	unsigned long long xcr0 = _xgetbv(0);
+	__cpuidex(info, 7, 0);
+	if (avx512) {
+		return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+	}
+	return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+#else
+	return avx512 ? __builtin_cpu_supports("avx512f") : __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static void horizontal_generic(const float* input, float* output, int begin, int end) {
+	horizontal_scalar(input, output, begin, end);
+}
+
+static void vertical_generic(const float* const* rows, float* output, int width) {
+	vertical_scalar(rows, output, 0, width);
+}
+
+struct ConvolutionDispatch {
+	void (*horizontal)(const float*, float*, int, int);
+	void (*vertical)(const float* const*, float*, int);
+	const char* name;
+};
+
+static ConvolutionDispatch select_dispatch() {
+#ifdef CONVOLUTION_X86
+	if (cpu_supports(true)) {
+		return { horizontal_avx512, vertical_avx512, "AVX-512" };
+	}
+	if (cpu_supports(false)) {
+		return { horizontal_avx2, vertical_avx2, "AVX2" };
+	}
+#endif
+	return { horizontal_generic, vertical_generic, "scalar" };
+}
+
+static const ConvolutionDispatch dispatch = select_dispatch();
+
+bool ConvolutionSIMD::is_standard_window(const float* kern, int ksize) {
+	return ksize == TAPS && std::equal(kern, kern + ksize, WEIGHTS);
+}
+
+void ConvolutionSIMD::horizontal(const float* input, float* output, int begin, int end) {
+	dispatch.horizontal(input, output, begin, end);
+}
+
+void ConvolutionSIMD::vertical(const float* const* rows, float* output, int width) {
+	dispatch.vertical(rows, output, width);
+}
+
+const char* ConvolutionSIMD::instruction_set() {
+	return dispatch.name;
+}
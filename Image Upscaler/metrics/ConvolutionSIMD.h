@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ * Row kernels for the standard SSIM window (11 taps, sigma = 1.5) with the weights as
+ * compile-time constants. Each kernel exists as AVX-512, AVX2 and scalar code and the
+ * widest one the CPU supports is picked once at startup. Every variant multiplies and
+ * then adds in tap order, exactly like the scalar loops, so results do not depend on
+ * the instruction set - provided the compiler does not contract a multiply and add into
+ * an FMA; CMakeLists.txt builds this file and Metrics.cpp with -ffp-contract=off for that.
+ */
+class ConvolutionSIMD {
+public:
+	static constexpr int TAPS = 11;
+	static constexpr int HALF = TAPS / 2;
+	// create_gaussian_kernel_1d(11, 1.5) evaluated in float
+	static constexpr float WEIGHTS[TAPS] = {
+		1.028380357e-03f, 7.598758675e-03f, 3.600077331e-02f, 1.093606949e-01f,
+		2.130055428e-01f, 2.660117447e-01f, 2.130055428e-01f, 1.093606949e-01f,
+		3.600077331e-02f, 7.598758675e-03f, 1.028380357e-03f
+	};
+
+	static bool is_standard_window(const float* kern, int ksize);
+
+	// Interior of one row: output[x] for x in [begin, end), reading input[x - HALF .. x + HALF]
+	static void horizontal(const float* input, float* output, int begin, int end);
+	// output[x] = Σ WEIGHTS[k] * rows[k][x] for x in [0, width)
+	static void vertical(const float* const* rows, float* output, int width);
+
+	static const char* instruction_set();
+};
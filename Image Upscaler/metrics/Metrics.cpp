@@ -1,11 +1,382 @@
-﻿#include "Metrics.h"
+﻿#include <cmath>
+#include <numeric>
+#include "Metrics.h"
+#include "ConvolutionSIMD.h"
+#include "../core/ThreadBudget.h"
+#include "../core/Trace.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define METRICS_SSE2 1
+#include <emmintrin.h>
+#endif
 
 double Metrics::calculatePSNR(const Image& img1, const Image& img2) {
-	if (img1.getWidth() != img2.getWidth() || img1.getHeight() != img2.getHeight()) {
+	return calculatePSNR(img1.view(), img2.view());
+}
+
+double Metrics::calculateSSIM(const Image& img1, const Image& img2) {
+	return calculateSSIM(img1.view(), img2.view());
+}
+
+double Metrics::calculatePSNR(const ImageView& img1, const ImageView& img2) {
+	if (img1.width != img2.width || img1.height != img2.height) {
 		std::cerr << "Error: Images must be of the same dimensions for PSNR calculation." << std::endl;
 		return -1.0;
 	}
-	double mse = calculateMSE(img1, img2);
+	return psnr_from_mse(calculateMSE(img1, img2));
+}
+
+/**
+SSIM formula: SSIM(x, y) = ((2 * μx * μy + C1) * (2 * σxy + C2)) / ((μx^2 + μy^2 + C1) * (σx^2 + σy^2 + C2))
+*/
+double Metrics::calculateSSIM(const ImageView& img1, const ImageView& img2) {
+	if (img1.width != img2.width || img1.height != img2.height) {
+		std::cerr << "Error: Images must be of the same dimensions for SSIM calculation." << std::endl;
+		return -1.0;
+	}
+
+	// 11 taps, sigma = 1.5; these exact weights select the SIMD row kernels
+	const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+
+	if (img1.grayscale) {
+		double ssim = 0.0;
+		ssim_pass(img1, img2, { Channel::R }, kernel1d, &ssim, nullptr);
+		return ssim;
+	}
+
+	double channel_ssim[3];
+	ssim_pass(img1, img2, { Channel::R, Channel::G, Channel::B }, kernel1d, channel_ssim, nullptr);
+	return (channel_ssim[0] + channel_ssim[1] + channel_ssim[2]) / 3.0;
+}
+
+/**
+ PSNR, SSIM and the per-pixel error statistics in one pass: the error sums are taken
+ from the same pixel rows the SSIM pass loads, so no metric walks the images again.
+ In luma space only the Y plane is compared, and mse/mae/max_error are in Y units.
+*/
+MetricSet Metrics::evaluate(const ImageView& reference, const ImageView& test, const MetricOptions& options) {
+	TRACE_SCOPE("Metrics::evaluate");
+	MetricSet result;
+	ImageView ref, tst;
+	if (!prepare_pair(reference, test, options.border, "metric evaluation", ref, tst)) {
+		result.psnr = -1.0;
+		result.ssim = -1.0;
+		return result;
+	}
+
+	const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+	const std::vector<Channel> channels = channels_for(ref.grayscale, options.space);
+
+	std::vector<double> channel_ssim(channels.size());
+	ErrorSums errors;
+	SSIMTileMap tiles;
+	if (options.tile_size > 0) {
+		init_tile_map(tiles, options.tile_size, ref.width, ref.height, options.border);
+	}
+	ssim_pass(ref, tst, channels, kernel1d, channel_ssim.data(), &errors, options.tile_size > 0 ? &tiles : nullptr);
+	result = make_metric_set(channel_ssim, errors, static_cast<double>(ref.width) * ref.height);
+	result.tiles = std::move(tiles);
+	return result;
+}
+
+MetricSet Metrics::evaluate(const Image& reference, const Image& test, const MetricOptions& options) {
+	return evaluate(reference.view(), test.view(), options);
+}
+
+/**
+ evaluate() against a prebuilt reference context: the reference's planes, μ and E[x²] are
+ read from the context instead of being loaded and filtered again, which leaves three of
+ the five moment convolutions per comparison. Results are identical to evaluate().
+*/
+MetricSet Metrics::evaluate(const ReferenceContext& reference, const ImageView& test) {
+	TRACE_SCOPE("Metrics::evaluate");
+	MetricSet result;
+	result.psnr = -1.0;
+	result.ssim = -1.0;
+	ImageView tst;
+	if (!prepare_context_pair(reference, test, "metric evaluation", tst)) {
+		return result;
+	}
+
+	const MetricOptions& options = reference.options;
+	const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+	const std::vector<Channel> channels = channels_for(reference.grayscale, options.space);
+	std::vector<double> channel_ssim(channels.size());
+	ErrorSums errors;
+	SSIMTileMap tiles;
+	if (options.tile_size > 0) {
+		init_tile_map(tiles, options.tile_size, tst.width, tst.height, options.border);
+	}
+	ssim_pass(tst, tst, channels, kernel1d, channel_ssim.data(), &errors, options.tile_size > 0 ? &tiles : nullptr, &reference);
+	result = make_metric_set(channel_ssim, errors, static_cast<double>(tst.width) * tst.height);
+	result.tiles = std::move(tiles);
+	return result;
+}
+
+double Metrics::calculatePSNR(const ReferenceContext& reference, const ImageView& test) {
+	ImageView tst;
+	if (!prepare_context_pair(reference, test, "PSNR calculation", tst)) {
+		return -1.0;
+	}
+	const std::vector<Channel> channels = channels_for(reference.grayscale, reference.options.space);
+	const ReferenceContext::Level& base = reference.levels[0];
+	const size_t size = static_cast<size_t>(base.width) * base.height;
+	std::vector<double> row_squared(tst.height);
+
+	#pragma omp parallel num_threads(ThreadBudget::per_job())
+	{
+		std::vector<float> line(tst.width);
+		#pragma omp for schedule(static)
+		for (int y = 0; y < tst.height; y++) {
+			double squared = 0.0;
+			for (size_t c = 0; c < channels.size(); c++) {
+				load_channel(tst.row(y), tst.width, channels[c], line.data());
+				squared += line_errors(base.plane.data() + c * size + static_cast<size_t>(y) * base.width, line.data(), tst.width).squared;
+			}
+			row_squared[y] = squared;
+		}
+	}
+
+	const double sum = std::accumulate(row_squared.begin(), row_squared.end(), 0.0);
+	return psnr_from_mse(sum / (static_cast<double>(size) * channels.size()));
+}
+
+double Metrics::calculateSSIM(const ReferenceContext& reference, const ImageView& test) {
+	ImageView tst;
+	if (!prepare_context_pair(reference, test, "SSIM calculation", tst)) {
+		return -1.0;
+	}
+	const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+	const std::vector<Channel> channels = channels_for(reference.grayscale, reference.options.space);
+	std::vector<double> channel_ssim(channels.size());
+	ssim_pass(tst, tst, channels, kernel1d, channel_ssim.data(), nullptr, nullptr, &reference);
+	return std::accumulate(channel_ssim.begin(), channel_ssim.end(), 0.0) / channels.size();
+}
+
+/**
+ Crops test by the context's border and checks it against the context's base level.
+*/
+bool Metrics::prepare_context_pair(const ReferenceContext& reference, const ImageView& test, const char* what, ImageView& out) {
+	if (reference.empty()) {
+		std::cerr << "Error: Reference context is empty for " << what << "." << std::endl;
+		return false;
+	}
+	const int border = reference.options.border;
+	const ReferenceContext::Level& base = reference.levels[0];
+	if (test.width - 2 * border != base.width || test.height - 2 * border != base.height || test.grayscale != reference.grayscale) {
+		std::cerr << "Error: Images must be of the same dimensions for " << what << "." << std::endl;
+		return false;
+	}
+	out = test.crop(border, border, base.width, base.height);
+	return true;
+}
+
+/**
+ evaluate() over two row sources, holding at most band_rows plus the SSIM window's reach of
+ rows from each. Every band runs the same row kernel as the in-memory pass with the window
+ clamped to the whole image, and the per-row sums are added in the same order, so the result
+ is identical to evaluate() on the full images.
+*/
+MetricSet Metrics::evaluateStreaming(IRowSource& reference, IRowSource& test, const MetricOptions& options, int band_rows) {
+	TRACE_SCOPE("Metrics::evaluate_streaming");
+	MetricSet result;
+	result.psnr = -1.0;
+	result.ssim = -1.0;
+	const int full_width = reference.width();
+	const int border = options.border;
+	if (full_width != test.width() || reference.height() != test.height()) {
+		std::cerr << "Error: Images must be of the same dimensions for metric evaluation." << std::endl;
+		return result;
+	}
+	if (border < 0 || 2 * border >= full_width || 2 * border >= reference.height()) {
+		std::cerr << "Error: Border of " << border << " pixels leaves nothing to compare for metric evaluation." << std::endl;
+		return result;
+	}
+
+	const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+	const int half = static_cast<int>(kernel1d.size()) / 2;
+	const bool grayscale = reference.grayscale();
+	const std::vector<Channel> channels = channels_for(grayscale, options.space);
+	const int width = full_width - 2 * border;
+	const int height = reference.height() - 2 * border;
+	band_rows = (std::max)(1, band_rows);
+
+	// Rows [first, first + count) of the cropped image, full width, back to back
+	const size_t capacity = static_cast<size_t>(band_rows) + 2 * half;
+	std::vector<Pixel> rows1(capacity * full_width);
+	std::vector<Pixel> rows2(capacity * full_width);
+	int first = 0;
+	int count = 0;
+
+	for (int skipped = 0; skipped < border;) {
+		int n = (std::min)(border - skipped, static_cast<int>(capacity));
+		reference.read_rows(rows1.data(), n);
+		test.read_rows(rows2.data(), n);
+		skipped += n;
+	}
+
+	std::vector<double> row_sums(static_cast<size_t>(band_rows) * channels.size());
+	std::vector<ErrorSums> band_errors(band_rows);
+	std::vector<double> channel_sums(channels.size(), 0.0);
+	ErrorSums errors;
+
+	SSIMTileMap tiles;
+	std::vector<double> row_tiles;
+	std::vector<double> tile_sums;
+	if (options.tile_size > 0) {
+		init_tile_map(tiles, options.tile_size, width, height, border);
+		row_tiles.resize(static_cast<size_t>(band_rows) * tiles.tiles_x);
+		tile_sums.assign(tiles.ssim.size(), 0.0);
+	}
+	RowOutputs out;
+	out.ssim = row_sums.data();
+	out.errors = band_errors.data();
+	out.tiles = row_tiles.empty() ? nullptr : row_tiles.data();
+	out.tile_size = options.tile_size;
+
+	for (int y_begin = 0; y_begin < height; y_begin += band_rows) {
+		const int y_end = (std::min)(height, y_begin + band_rows);
+		const int needed_first = (std::max)(0, y_begin - half);
+		const int needed_end = (std::min)(height, y_end + half);
+
+		// Keep the rows the next band's window still reaches, read the ones it adds
+		const int dropped = needed_first - first;
+		if (dropped > 0) {
+			std::copy(rows1.begin() + static_cast<size_t>(dropped) * full_width, rows1.begin() + static_cast<size_t>(count) * full_width, rows1.begin());
+			std::copy(rows2.begin() + static_cast<size_t>(dropped) * full_width, rows2.begin() + static_cast<size_t>(count) * full_width, rows2.begin());
+			first = needed_first;
+			count -= dropped;
+		}
+		const int added = needed_end - (first + count);
+		reference.read_rows(rows1.data() + static_cast<size_t>(count) * full_width, added);
+		test.read_rows(rows2.data() + static_cast<size_t>(count) * full_width, added);
+		count += added;
+
+		const ImageView band1 = ImageView{ rows1.data(), full_width, count, full_width, grayscale }.crop(border, 0, width, count);
+		const ImageView band2 = ImageView{ rows2.data(), full_width, count, full_width, grayscale }.crop(border, 0, width, count);
+		if (out.tiles) {
+			std::fill(row_tiles.begin(), row_tiles.end(), 0.0);
+		}
+		ssim_rows(band1, band2, first, height, y_begin, y_end, channels, kernel1d, nullptr, out);
+		if (out.tiles) {
+			add_tile_rows(tiles, row_tiles.data(), y_begin, y_end, tile_sums);
+		}
+
+		for (int y = 0; y < y_end - y_begin; y++) {
+			for (size_t c = 0; c < channels.size(); c++) {
+				channel_sums[c] += row_sums[static_cast<size_t>(y) * channels.size() + c];
+			}
+			errors.add(band_errors[y]);
+		}
+	}
+
+	const double pixels = static_cast<double>(width) * height;
+	std::vector<double> channel_ssim(channels.size());
+	for (size_t c = 0; c < channels.size(); c++) {
+		channel_ssim[c] = channel_sums[c] / pixels;
+	}
+	result = make_metric_set(channel_ssim, errors, pixels);
+	if (out.tiles) {
+		finish_tile_map(tiles, tile_sums, static_cast<int>(channels.size()));
+		result.tiles = std::move(tiles);
+	}
+	return result;
+}
+
+MetricSet Metrics::make_metric_set(const std::vector<double>& channel_ssim, const ErrorSums& errors, double pixels) {
+	MetricSet result;
+	// A single compared plane yields one error sample per pixel, otherwise every byte counts
+	const double samples = pixels * (channel_ssim.size() == 1 ? 1 : 3);
+	result.mse = errors.squared / samples;
+	result.psnr = psnr_from_mse(result.mse);
+	result.ssim = std::accumulate(channel_ssim.begin(), channel_ssim.end(), 0.0) / channel_ssim.size();
+	result.mae = errors.absolute / samples;
+	result.max_error = errors.max_abs;
+	return result;
+}
+
+double Metrics::calculateLumaPSNR(const Image& img1, const Image& img2, int border) {
+	return calculateLumaPSNR(img1.view(), img2.view(), border);
+}
+
+double Metrics::calculateLumaSSIM(const Image& img1, const Image& img2, int border) {
+	return calculateLumaSSIM(img1.view(), img2.view(), border);
+}
+
+/**
+ PSNR of the Y plane with border pixels shaved off each side, as reported in the SR literature.
+ Y is computed per row while the pixels are read; no luma image is materialized.
+*/
+double Metrics::calculateLumaPSNR(const ImageView& img1, const ImageView& img2, int border) {
+	ImageView a, b;
+	if (!prepare_pair(img1, img2, border, "PSNR calculation", a, b)) {
+		return -1.0;
+	}
+	const Channel channel = luma_channel(a.grayscale);
+	std::vector<double> row_squared(a.height);
+
+	#pragma omp parallel num_threads(ThreadBudget::per_job())
+	{
+		std::vector<float> line_a(a.width), line_b(a.width);
+		#pragma omp for schedule(static)
+		for (int y = 0; y < a.height; y++) {
+			load_channel(a.row(y), a.width, channel, line_a.data());
+			load_channel(b.row(y), a.width, channel, line_b.data());
+			row_squared[y] = line_errors(line_a.data(), line_b.data(), a.width).squared;
+		}
+	}
+
+	const double sum = std::accumulate(row_squared.begin(), row_squared.end(), 0.0);
+	return psnr_from_mse(sum / (static_cast<double>(a.width) * a.height));
+}
+
+/**
+ SSIM of the Y plane with border pixels shaved off each side: one set of convolutions instead of three.
+*/
+double Metrics::calculateLumaSSIM(const ImageView& img1, const ImageView& img2, int border) {
+	ImageView a, b;
+	if (!prepare_pair(img1, img2, border, "SSIM calculation", a, b)) {
+		return -1.0;
+	}
+	const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+	double ssim = 0.0;
+	ssim_pass(a, b, { luma_channel(a.grayscale) }, kernel1d, &ssim, nullptr);
+	return ssim;
+}
+
+/**
+ Checks that both images match in size and crops border pixels from every side of each.
+*/
+bool Metrics::prepare_pair(const ImageView& img1, const ImageView& img2, int border, const char* what, ImageView& out1, ImageView& out2) {
+	if (img1.width != img2.width || img1.height != img2.height) {
+		std::cerr << "Error: Images must be of the same dimensions for " << what << "." << std::endl;
+		return false;
+	}
+	if (border < 0 || 2 * border >= img1.width || 2 * border >= img1.height) {
+		std::cerr << "Error: Border of " << border << " pixels leaves nothing to compare for " << what << "." << std::endl;
+		return false;
+	}
+	out1 = img1.crop(border, border, img1.width - 2 * border, img1.height - 2 * border);
+	out2 = img2.crop(border, border, img2.width - 2 * border, img2.height - 2 * border);
+	return true;
+}
+
+std::vector<Metrics::Channel> Metrics::channels_for(bool grayscale, ColorSpace space) {
+	if (space == ColorSpace::Luma) {
+		return { luma_channel(grayscale) };
+	}
+	if (grayscale) {
+		return { Channel::R };
+	}
+	return { Channel::R, Channel::G, Channel::B };
+}
+
+// Grayscale images already store luma; converting them would rescale it to the [16, 235] range
+Metrics::Channel Metrics::luma_channel(bool grayscale) {
+	return grayscale ? Channel::R : Channel::Y;
+}
+
+double Metrics::psnr_from_mse(double mse) {
 	if (mse == 0) {
 		return INFINITY; // Images are identical
 	}
@@ -13,118 +384,702 @@ double Metrics::calculatePSNR(const Image& img1, const Image& img2) {
 }
 
 /**
-SSIM formula: SSIM(x, y) = ((2 * μx * μy + C1) * (2 * σxy + C2)) / ((μx^2 + μy^2 + C1) * (σx^2 + σy^2 + C2))
+ Sum of squared differences over all channels, accumulated exactly in integers.
+ Rows are reduced in parallel; every row is a flat run of 3 * width bytes.
 */
-double Metrics::calculateSSIM(const Image& img1, const Image& img2) {
-	if (img1.getWidth() != img2.getWidth() || img1.getHeight() != img2.getHeight()) {
-		std::cerr << "Error: Images must be of the same dimensions for SSIM calculation." << std::endl;
-		return -1.0;
+double Metrics::calculateMSE(const ImageView& img1, const ImageView& img2) {
+	TRACE_SCOPE("Metrics::mse");
+	const int row_bytes = img1.width * static_cast<int>(sizeof(Pixel));
+	long long sum = 0;
+
+	#pragma omp parallel for reduction(+:sum) schedule(static) num_threads(ThreadBudget::per_job())
+	for (int y = 0; y < img1.height; y++) {
+		const unsigned char* a = &img1.row(y)->r;
+		const unsigned char* b = &img2.row(y)->r;
+		sum += static_cast<long long>(row_errors(a, b, row_bytes).squared);
 	}
 
-	int width = img1.getWidth();
-	int height = img1.getHeight();
-	int N = width * height;
-	const std::vector<Pixel> data1 = img1.getData();
-	const std::vector<Pixel> data2 = img2.getData();
+	return static_cast<double>(sum) / (static_cast<double>(img1.width) * img1.height * 3);
+}
 
-	std::vector<float> kernel1d = create_gaussian_kernel_1d(11, 1.5);
+void Metrics::ErrorSums::add(const ErrorSums& other) {
+	squared += other.squared;
+	absolute += other.absolute;
+	max_abs = (std::max)(max_abs, other.max_abs);
+}
 
-	if (img1.isGrayScale()) {
-		std::vector<float> gray1(N), gray2(N);
-		for (int i = 0; i < N; i++) {
-			gray1[i] = data1[i].r;
-			gray2[i] = data2[i].r;
+/**
+ Σ (a[i] - b[i])², Σ |a[i] - b[i]| and max |a[i] - b[i]| over count bytes, summed exactly in integers.
+ The SSE2 path takes the byte-wise absolute difference once; psadbw sums it straight into
+ 64-bit lanes, and pmaddwd squares its 16-bit widening into 32-bit lanes, which are flushed
+ to the 64-bit total every 16K bytes before they can overflow (16384 * 255² < 2^31).
+*/
+Metrics::ErrorSums Metrics::row_errors(const unsigned char* a, const unsigned char* b, int count) {
+	unsigned long long squared = 0;
+	unsigned long long absolute = 0;
+	int max_abs = 0;
+	int i = 0;
+
+#ifdef METRICS_SSE2
+	constexpr int CHUNK = 16384;
+	const __m128i zero = _mm_setzero_si128();
+	__m128i abs_acc = _mm_setzero_si128();
+	__m128i max_acc = _mm_setzero_si128();
+	while (i + 16 <= count) {
+		const int chunk_end = (std::min)(count, i + CHUNK);
+		__m128i sq_acc = _mm_setzero_si128();
+		for (; i + 16 <= chunk_end; i += 16) {
+			__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+			__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+			__m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+			__m128i lo = _mm_unpacklo_epi8(diff, zero);
+			__m128i hi = _mm_unpackhi_epi8(diff, zero);
+			sq_acc = _mm_add_epi32(sq_acc, _mm_madd_epi16(lo, lo));
+			sq_acc = _mm_add_epi32(sq_acc, _mm_madd_epi16(hi, hi));
+			abs_acc = _mm_add_epi64(abs_acc, _mm_sad_epu8(diff, zero));
+			max_acc = _mm_max_epu8(max_acc, diff);
 		}
-		return calculate_ssim_single_channel(gray1.data(), gray2.data(), width, height, kernel1d);
+		alignas(16) unsigned int lanes[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes), sq_acc);
+		squared += static_cast<unsigned long long>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
 	}
-	else {
-		return calculate_ssim_rgb(data1, data2, width, height, kernel1d);
+	alignas(16) unsigned long long abs_lanes[2];
+	alignas(16) unsigned char max_lanes[16];
+	_mm_store_si128(reinterpret_cast<__m128i*>(abs_lanes), abs_acc);
+	_mm_store_si128(reinterpret_cast<__m128i*>(max_lanes), max_acc);
+	absolute = abs_lanes[0] + abs_lanes[1];
+	max_abs = *std::max_element(max_lanes, max_lanes + 16);
+#endif
+
+	for (; i < count; i++) {
+		int d = std::abs(a[i] - b[i]);
+		squared += static_cast<unsigned long long>(d * d);
+		absolute += d;
+		max_abs = (std::max)(max_abs, d);
 	}
+
+	ErrorSums sums;
+	sums.squared = static_cast<double>(squared);
+	sums.absolute = static_cast<double>(absolute);
+	sums.max_abs = max_abs;
+	return sums;
 }
 
-double Metrics::calculateMSE(const Image& img1, const Image& img2) {
-	double sum = 0.0;
-	int n = img1.getWidth() * img1.getHeight() * 3;
+/**
+ The same statistics over two float lines, e.g. Y values that are not integers.
+*/
+Metrics::ErrorSums Metrics::line_errors(const float* a, const float* b, int count) {
+	ErrorSums sums;
+	for (int i = 0; i < count; i++) {
+		double d = std::abs(static_cast<double>(a[i]) - b[i]);
+		sums.squared += d * d;
+		sums.absolute += d;
+		sums.max_abs = (std::max)(sums.max_abs, d);
+	}
+	return sums;
+}
+
+/**
+ SSIM of every channel, plus the error sums when errors is set, over whole views.
+ Per-row sums are added in row order, so the result does not depend on the thread count.
+*/
+void Metrics::ssim_pass(const ImageView& img1, const ImageView& img2, const std::vector<Channel>& channels, const std::vector<float>& kernel1d, double* channel_ssim, ErrorSums* errors, SSIMTileMap* tiles, const ReferenceContext* reference) {
+	TRACE_SCOPE("Metrics::ssim_pass");
+	const int height = img1.height;
+	std::vector<double> row_sums(static_cast<size_t>(height) * channels.size(), 0.0);
+	std::vector<ErrorSums> row_errors_sums(errors ? height : 0);
+	std::vector<double> row_tiles(tiles ? static_cast<size_t>(height) * tiles->tiles_x : 0, 0.0);
+	RowOutputs out;
+	out.ssim = row_sums.data();
+	out.errors = errors ? row_errors_sums.data() : nullptr;
+	out.tiles = tiles ? row_tiles.data() : nullptr;
+	out.tile_size = tiles ? tiles->tile_size : 0;
+	ssim_rows(img1, img2, 0, height, 0, height, channels, kernel1d, reference, out);
+
+	const double pixels = static_cast<double>(img1.width) * height;
+	for (size_t c = 0; c < channels.size(); c++) {
+		double ssim_sum = 0.0;
+		for (int y = 0; y < height; y++) {
+			ssim_sum += row_sums[static_cast<size_t>(y) * channels.size() + c];
+		}
+		channel_ssim[c] = ssim_sum / pixels;
+	}
+
+	if (errors) {
+		for (const ErrorSums& row_error : row_errors_sums) {
+			errors->add(row_error);
+		}
+	}
 
-	std::vector<Pixel> data1 = img1.getData();
-	std::vector<Pixel> data2 = img2.getData();
+	if (tiles) {
+		std::vector<double> tile_sums(tiles->ssim.size(), 0.0);
+		add_tile_rows(*tiles, row_tiles.data(), 0, height, tile_sums);
+		finish_tile_map(*tiles, tile_sums, static_cast<int>(channels.size()));
+	}
+}
 
-	for (int i = 0; i < data1.size(); i++) {
-		sum += std::pow(data1[i].r - data2[i].r, 2);
-		sum += std::pow(data1[i].g - data2[i].g, 2);
-		sum += std::pow(data1[i].b - data2[i].b, 2);
+/**
+ Sizes a tile map for a compared area of width x height that starts border pixels into the image.
+*/
+void Metrics::init_tile_map(SSIMTileMap& map, int tile_size, int width, int height, int border) {
+	map.tile_size = tile_size;
+	map.tiles_x = (width + tile_size - 1) / tile_size;
+	map.tiles_y = (height + tile_size - 1) / tile_size;
+	map.origin_x = border;
+	map.origin_y = border;
+	map.width = width;
+	map.height = height;
+	map.ssim.assign(static_cast<size_t>(map.tiles_x) * map.tiles_y, 0.0f);
+}
+
+// Folds per-row tile sums for rows [y_begin, y_end) into the running per-tile sums, in row order
+void Metrics::add_tile_rows(const SSIMTileMap& map, const double* row_tiles, int y_begin, int y_end, std::vector<double>& tile_sums) {
+	for (int y = y_begin; y < y_end; y++) {
+		double* tile_row = tile_sums.data() + static_cast<size_t>(y / map.tile_size) * map.tiles_x;
+		const double* sums = row_tiles + static_cast<size_t>(y - y_begin) * map.tiles_x;
+		for (int tx = 0; tx < map.tiles_x; tx++) {
+			tile_row[tx] += sums[tx];
+		}
 	}
+}
 
-	return sum / n;
+// Turns per-tile SSIM sums over all channels into means; edge tiles may be partial
+void Metrics::finish_tile_map(SSIMTileMap& map, const std::vector<double>& tile_sums, int channels) {
+	for (int ty = 0; ty < map.tiles_y; ty++) {
+		const int tile_height = (std::min)(map.tile_size, map.height - ty * map.tile_size);
+		for (int tx = 0; tx < map.tiles_x; tx++) {
+			const int tile_width = (std::min)(map.tile_size, map.width - tx * map.tile_size);
+			const size_t i = static_cast<size_t>(ty) * map.tiles_x + tx;
+			map.ssim[i] = static_cast<float>(tile_sums[i] / (static_cast<double>(tile_width) * tile_height * channels));
+		}
+	}
 }
 
-double Metrics::calculate_ssim_single_channel(const float* ch1, const float* ch2, int width, int height, const std::vector<float>& kernel1d) {
+/**
+ Fused, row-streaming SSIM over one or more channels of interleaved 8-bit pixels, for output
+ rows [y_begin, y_end) of an image full_height rows tall. The views hold rows starting at
+ global row row_offset and must cover the window of every output row, clamped to the image.
+ The rows are split into horizontal bands, one per thread. For every channel each band
+ keeps a ring of ksize horizontally filtered rows for all five moments (x, y, x², y², xy);
+ every output row is one vertical pass over the rings followed by the SSIM formula, so
+ scratch is channels * 5 * (ksize + 2) * width floats per band instead of full-size planes.
+ Each source row is loaded once for all channels; when out.errors is set, the band's own rows
+ also feed the error sums. Channel::Y is converted from RGB as the row is loaded.
+ When out.tiles is set, each output row's SSIM values are also summed per tile column straight
+ from the row loop, so tile statistics need no second pass over the map.
+ With a reference context, img1 is not read: x comes from the context's planes and μx, E[x²]
+ from its filtered maps, so only the y, y² and xy moments are filtered.
+*/
+void Metrics::ssim_rows(const ImageView& img1, const ImageView& img2, int row_offset, int full_height, int y_begin, int y_end, const std::vector<Channel>& channels, const std::vector<float>& kernel1d, const ReferenceContext* reference, const RowOutputs& out) {
 	constexpr float C1 = 6.5025f;
 	constexpr float C2 = 58.5225f;
-	int N = width * height;
+	constexpr int MOMENTS = 5;
+	const int ksize = static_cast<int>(kernel1d.size());
+	const int half = ksize / 2;
+	const float* kern = kernel1d.data();
+	const int width = img1.width;
+	const int height = full_height;
+	const int planes = static_cast<int>(channels.size()) * MOMENTS;
+
+	const int rows = y_end - y_begin;
+	const int bands = (std::max)(1, (std::min)(rows, ThreadBudget::per_job()));
+	// A single plane or a context's planes are compared on their float values; otherwise the raw pixel bytes
+	const bool plane_errors = channels.size() == 1 || reference;
+	const ReferenceContext::Level* base = reference ? &reference->levels[0] : nullptr;
+	const size_t plane_size = base ? static_cast<size_t>(base->width) * base->height : 0;
+	// Moments x and x² (0 and 2) of every channel come filtered from the context
+	auto filtered = [&](int p) {
+		return !reference || (p % MOMENTS != 0 && p % MOMENTS != 2);
+	};
+	// Without tiles the row is one segment, which keeps its summation order unchanged
+	const int segment = out.tiles ? out.tile_size : width;
+	const int tiles_x = out.tiles ? (width + out.tile_size - 1) / out.tile_size : 0;
+
+	#pragma omp parallel for schedule(static) num_threads(ThreadBudget::per_job())
+	for (int band = 0; band < bands; band++) {
+		const int band_begin = y_begin + static_cast<int>(static_cast<long long>(rows) * band / bands);
+		const int band_end = y_begin + static_cast<int>(static_cast<long long>(rows) * (band + 1) / bands);
+
+		// Plane p = channel * MOMENTS + moment; plane p of source row r lives in ring slot (p * ksize + r % ksize)
+		std::vector<float> ring(static_cast<size_t>(planes) * ksize * width);
+		std::vector<float> line(static_cast<size_t>(planes) * width);
+		std::vector<float> mean(static_cast<size_t>(planes) * width);
+		std::vector<const float*> taps(ksize);
+
+		auto ring_row = [&](int p, int row) {
+			return ring.data() + (static_cast<size_t>(p) * ksize + row % ksize) * width;
+		};
+
+		int next_row = (std::max)(0, band_begin - half);
+		for (int y = band_begin; y < band_end; y++) {
+			// Filter horizontally every source row the vertical window of y needs
+			const int last_needed = (std::min)(height - 1, y + half);
+			for (; next_row <= last_needed; next_row++) {
+				const Pixel* src1 = img1.row(next_row - row_offset);
+				const Pixel* src2 = img2.row(next_row - row_offset);
+				const bool own_row = out.errors && next_row >= band_begin && next_row < band_end;
+				if (own_row && !plane_errors) {
+					out.errors[next_row - y_begin] = row_errors(&src1->r, &src2->r, width * static_cast<int>(sizeof(Pixel)));
+				}
+
+				for (size_t c = 0; c < channels.size(); c++) {
+					float* lx = line.data() + c * MOMENTS * width;
+					float* ly = lx + width;
+					float* lxx = ly + width;
+					float* lyy = lxx + width;
+					float* lxy = lyy + width;
+					if (reference) {
+						const float* plane_row = base->plane.data() + c * plane_size + static_cast<size_t>(next_row) * width;
+						std::copy_n(plane_row, width, lx);
+					}
+					else {
+						load_channel(src1, width, channels[c], lx);
+					}
+					load_channel(src2, width, channels[c], ly);
+					if (own_row && plane_errors) {
+						ErrorSums& row_error = out.errors[next_row - y_begin];
+						if (c == 0) {
+							row_error = line_errors(lx, ly, width);
+						}
+						else {
+							row_error.add(line_errors(lx, ly, width));
+						}
+					}
+					for (int x = 0; x < width; x++) {
+						float a = lx[x];
+						float b = ly[x];
+						lxx[x] = a * a;
+						lyy[x] = b * b;
+						lxy[x] = a * b;
+					}
+				}
+				for (int p = 0; p < planes; p++) {
+					if (filtered(p)) {
+						filter_row_horizontal(line.data() + static_cast<size_t>(p) * width, ring_row(p, next_row), width, kern, ksize);
+					}
+				}
+			}
+
+			// μx, μy, E[x²], E[y²], E[xy] for row y; borders replicate the edge rows
+			for (int p = 0; p < planes; p++) {
+				if (!filtered(p)) {
+					continue;
+				}
+				for (int k = 0; k < ksize; k++) {
+					taps[k] = ring_row(p, std::clamp(y + k - half, 0, height - 1));
+				}
+				filter_rows_vertical(taps.data(), mean.data() + static_cast<size_t>(p) * width, width, kern, ksize);
+			}
+
+			for (size_t c = 0; c < channels.size(); c++) {
+				const float* mu_1 = mean.data() + c * MOMENTS * width;
+				const float* mu_2 = mu_1 + width;
+				const float* sigma_1_sq = mu_2 + width;
+				const float* sigma_2_sq = sigma_1_sq + width;
+				if (reference) {
+					const size_t offset = c * plane_size + static_cast<size_t>(y) * width;
+					mu_1 = base->mean.data() + offset;
+					sigma_1_sq = base->second_moment.data() + offset;
+				}
+				const float* sigma_12 = sigma_2_sq + width;
+				double row_sum = 0.0;
+				for (int x_begin = 0; x_begin < width; x_begin += segment) {
+					const int x_end = (std::min)(width, x_begin + segment);
+					double segment_sum = 0.0;
+					for (int x = x_begin; x < x_end; x++) {
+						double mux = mu_1[x];
+						double muy = mu_2[x];
+
+						// σ² = E[x²] - μ²
+						double sigmax2 = sigma_1_sq[x] - mux * mux;
+						double sigmay2 = sigma_2_sq[x] - muy * muy;
+						double sigmaxy = sigma_12[x] - mux * muy;
+
+						double numerator = (2 * mux * muy + C1) * (2 * sigmaxy + C2);
+						double denominator = (mux * mux + muy * muy + C1) * (sigmax2 + sigmay2 + C2);
+
+						double ssim = numerator / denominator;
+						row_sum += ssim;
+						segment_sum += ssim;
+					}
+					if (out.tiles) {
+						out.tiles[static_cast<size_t>(y - y_begin) * tiles_x + x_begin / segment] += segment_sum;
+					}
+				}
+				out.ssim[static_cast<size_t>(y - y_begin) * channels.size() + c] = row_sum;
+			}
+		}
+	}
+}
+
+void Metrics::load_channel(const Pixel* row, int width, Channel channel, float* out) {
+	switch (channel) {
+	case Channel::R:
+		for (int x = 0; x < width; x++) out[x] = row[x].r;
+		break;
+	case Channel::G:
+		for (int x = 0; x < width; x++) out[x] = row[x].g;
+		break;
+	case Channel::B:
+		for (int x = 0; x < width; x++) out[x] = row[x].b;
+		break;
+	case Channel::Y: {
+		// ITU-R BT.601 studio range, Y in [16, 235]: the conversion MATLAB's rgb2ycbcr performs
+		constexpr float KR = 65.481f / 255.0f;
+		constexpr float KG = 128.553f / 255.0f;
+		constexpr float KB = 24.966f / 255.0f;
+		for (int x = 0; x < width; x++) out[x] = 16.0f + KR * row[x].r + KG * row[x].g + KB * row[x].b;
+		break;
+	}
+	}
+}
+
+double Metrics::calculateFastSSIM(const Image& img1, const Image& img2, const MetricOptions& options, int window) {
+	return calculateFastSSIM(img1.view(), img2.view(), options, window);
+}
+
+/**
+ SSIM with a uniform window instead of the Gaussian one, for bulk screening. The five moments
+ come from summed-area tables, so each pixel costs four lookups per moment whatever the window
+ size, against 22 taps per moment for the separable Gaussian. Windows are clipped at the image
+ edges. Values track calculateSSIM closely but do not match it.
+*/
+double Metrics::calculateFastSSIM(const ImageView& img1, const ImageView& img2, const MetricOptions& options, int window) {
+	TRACE_SCOPE("Metrics::fast_ssim");
+	ImageView a, b;
+	if (!prepare_pair(img1, img2, options.border, "fast SSIM calculation", a, b)) {
+		return -1.0;
+	}
+	if (window < 1 || window % 2 == 0) {
+		std::cerr << "Error: Fast SSIM window must be a positive odd size, got " << window << "." << std::endl;
+		return -1.0;
+	}
+
+	const std::vector<Channel> channels = channels_for(a.grayscale, options.space);
 	double ssim_sum = 0.0;
+	for (Channel channel : channels) {
+		ssim_sum += box_ssim_channel(a, b, channel, window / 2);
+	}
+	return ssim_sum / channels.size();
+}
 
-	// X^2, Y^2, XY
-	std::vector<float> ch1_sq(N), ch2_sq(N), ch12(N);
-	#pragma omp parallel for schedule(static)
-	for (int i = 0; i < N; i++) {
-		float a = ch1[i];
-		float b = ch2[i];
-		ch1_sq[i] = a * a;
-		ch2_sq[i] = b * b;
-		ch12[i] = a * b;
+/**
+ Box-window SSIM of one channel, streamed row by row. A summed-area table S gives any window sum as
+ S(y1, x1) - S(y1, x0) - S(y0, x1) + S(y0, x0); the vertical difference S(y1, ·) - S(y0, ·) is a
+ set of running column sums, updated per output row by adding the entering row and subtracting
+ the leaving one, and its horizontal prefix finishes the table lookup. So every moment costs
+ a constant handful of operations per pixel and a band keeps only a few rows of scratch.
+ Sums are doubles. For the 8-bit R, G and B channels they are exact integer sums; Channel::Y is a
+ float conversion, so its sums carry ordinary rounding error.
+*/
+double Metrics::box_ssim_channel(const ImageView& img1, const ImageView& img2, Channel channel, int half) {
+	constexpr double C1 = 6.5025;
+	constexpr double C2 = 58.5225;
+	constexpr int MOMENTS = 5;
+	constexpr int LANES = 8;
+
+	const int width = img1.width;
+	const int height = img1.height;
+	const size_t prefix_width = static_cast<size_t>(width) + 1;
+	std::vector<double> row_sums(height, 0.0);
+	const int bands = (std::max)(1, (std::min)(height, ThreadBudget::per_job()));
+
+	// Window columns [lo, hi) of every x, clipped at the image edges
+	std::vector<int> lo(width), hi(width);
+	std::vector<double> inv_cols(width);
+	for (int x = 0; x < width; x++) {
+		lo[x] = (std::max)(0, x - half);
+		hi[x] = (std::min)(width, x + half + 1);
+		inv_cols[x] = 1.0 / (hi[x] - lo[x]);
 	}
+	const int interior_begin = half;
 
-	// μx, μy
-	std::vector<float> mu_1(N), mu_2(N);
-	std::vector<float> sigma_1_sq(N), sigma_2_sq(N), sigma_12(N);
-	//  E[x²], E[y²], E[xy]
-	std::vector<float> temp1(N), temp2(N);
+	#pragma omp parallel for schedule(static) num_threads(ThreadBudget::per_job())
+	for (int band = 0; band < bands; band++) {
+		const int y_begin = static_cast<int>(static_cast<long long>(height) * band / bands);
+		const int y_end = static_cast<int>(static_cast<long long>(height) * (band + 1) / bands);
 
-	convolve_channel(ch1, mu_1.data(), width, height, kernel1d, temp1.data());
-	convolve_channel(ch2, mu_2.data(), width, height, kernel1d, temp2.data());
-	convolve_channel(ch1_sq.data(), sigma_1_sq.data(), width, height, kernel1d, temp1.data());
-	convolve_channel(ch2_sq.data(), sigma_2_sq.data(), width, height, kernel1d, temp2.data());
-	convolve_channel(ch12.data(), sigma_12.data(), width, height, kernel1d, temp1.data());
-	#pragma omp parallel for reduction(+:ssim_sum) schedule(static)
-	for (int i = 0; i < N; i++) {
-		double mux = mu_1[i];
-		double muy = mu_2[i];
-		float mux2 = mux * mux;
-		float muy2 = muy * muy;
+		// Moment planes: x, y, x², y², xy
+		std::vector<double> columns(static_cast<size_t>(MOMENTS) * width, 0.0);
+		std::vector<double> prefix(static_cast<size_t>(MOMENTS) * prefix_width, 0.0);
+		std::vector<double> means(static_cast<size_t>(MOMENTS) * width);
+		std::vector<double> ssim_map(width);
+		std::vector<float> lx(width), ly(width);
 
-		// σ² = E[x²] - μ²
-		double sigmax2 = sigma_1_sq[i] - mux * mux;
-		double sigmay2 = sigma_2_sq[i] - muy * muy;
-		double sigmaxy = sigma_12[i] - mux * muy;
+		auto accumulate_row = [&](int r, double sign) {
+			load_channel(img1.row(r), width, channel, lx.data());
+			load_channel(img2.row(r), width, channel, ly.data());
+			double* cx = columns.data();
+			double* cy = cx + width;
+			double* cxx = cy + width;
+			double* cyy = cxx + width;
+			double* cxy = cyy + width;
+			for (int x = 0; x < width; x++) {
+				double a = lx[x];
+				double b = ly[x];
+				cx[x] += sign * a;
+				cy[x] += sign * b;
+				cxx[x] += sign * (a * a);
+				cyy[x] += sign * (b * b);
+				cxy[x] += sign * (a * b);
+			}
+		};
 
-		double numerator = (2 * mux * muy + C1) * (2 * sigmaxy + C2);
-		double denominator = (mux * mux + muy * muy + C1) * (sigmax2 + sigmay2 + C2);
+		for (int r = (std::max)(0, y_begin - half); r <= (std::min)(height - 1, y_begin + half); r++) {
+			accumulate_row(r, 1.0);
+		}
 
-		ssim_sum += numerator / denominator;
+		for (int y = y_begin; y < y_end; y++) {
+			if (y > y_begin) {
+				if (y + half < height) accumulate_row(y + half, 1.0);
+				if (y - half - 1 >= 0) accumulate_row(y - half - 1, -1.0);
+			}
+			const double inv_rows = 1.0 / ((std::min)(height, y + half + 1) - (std::max)(0, y - half));
+
+			// One loop for all five prefixes: their dependency chains overlap instead of running back to back
+			const double* column = columns.data();
+			double* p = prefix.data();
+			for (int x = 0; x < width; x++) {
+				for (int m = 0; m < MOMENTS; m++) {
+					p[m * prefix_width + x + 1] = p[m * prefix_width + x] + column[static_cast<size_t>(m) * width + x];
+				}
+			}
+
+			for (int m = 0; m < MOMENTS; m++) {
+				const double* pm = prefix.data() + static_cast<size_t>(m) * prefix_width;
+				double* mean = means.data() + static_cast<size_t>(m) * width;
+				const int interior_end = (std::max)(interior_begin, width - half);
+				const double inv_interior = inv_rows / (2 * half + 1);
+				for (int x = 0; x < (std::min)(interior_begin, width); x++) {
+					mean[x] = (pm[hi[x]] - pm[lo[x]]) * inv_cols[x] * inv_rows;
+				}
+				for (int x = interior_begin; x < interior_end; x++) {
+					mean[x] = (pm[x + half + 1] - pm[x - half]) * inv_interior;
+				}
+				for (int x = (std::max)(interior_begin, interior_end); x < width; x++) {
+					mean[x] = (pm[hi[x]] - pm[lo[x]]) * inv_cols[x] * inv_rows;
+				}
+			}
+
+			const double* mu_1 = means.data();
+			const double* mu_2 = mu_1 + width;
+			const double* e_xx = mu_2 + width;
+			const double* e_yy = e_xx + width;
+			const double* e_xy = e_yy + width;
+			// The SSIM map row is written out so the divisions vectorize; the sum then runs in
+			// LANES independent chains rather than one serial chain of adds
+			for (int x = 0; x < width; x++) {
+				double mux = mu_1[x];
+				double muy = mu_2[x];
+				double sigmax2 = e_xx[x] - mux * mux;
+				double sigmay2 = e_yy[x] - muy * muy;
+				double sigmaxy = e_xy[x] - mux * muy;
+
+				double numerator = (2 * mux * muy + C1) * (2 * sigmaxy + C2);
+				double denominator = (mux * mux + muy * muy + C1) * (sigmax2 + sigmay2 + C2);
+				ssim_map[x] = numerator / denominator;
+			}
+			double lane_sums[LANES] = {};
+			int x = 0;
+			for (; x + LANES <= width; x += LANES) {
+				for (int l = 0; l < LANES; l++) {
+					lane_sums[l] += ssim_map[x + l];
+				}
+			}
+			for (; x < width; x++) {
+				lane_sums[0] += ssim_map[x];
+			}
+			row_sums[y] = std::accumulate(lane_sums, lane_sums + LANES, 0.0);
+		}
 	}
 
-	return ssim_sum / N;
+	return std::accumulate(row_sums.begin(), row_sums.end(), 0.0) / (static_cast<double>(width) * height);
 }
 
-double Metrics::calculate_ssim_rgb(const std::vector<Pixel>& data1, const std::vector<Pixel>& data2, int width, int height, const std::vector<float>& kernel1d) {
-	int N = width * height;
+size_t ReferenceContext::memory_bytes() const {
+	size_t floats = 0;
+	for (const Level& level : levels) {
+		floats += level.plane.size() + level.mean.size() + level.second_moment.size();
+	}
+	return floats * sizeof(float);
+}
+
+/**
+ Precomputes one image's half of the metric statistics: the channel planes (Y in luma space)
+ and their Gaussian-filtered mean and second moment, on a dyadic pyramid of up to 5 levels
+ for MS-SSIM. Level l + 1 is the 2x2 box average of level l; levels stop before a side
+ would reach zero pixels.
+*/
+ReferenceContext Metrics::buildReference(const ImageView& img, const MetricOptions& options) {
+	TRACE_SCOPE("Metrics::build_reference");
+	ReferenceContext context;
+	ImageView src, unused;
+	if (!prepare_pair(img, img, options.border, "reference context", src, unused)) {
+		return context;
+	}
 
-	std::vector<float> r1(N), g1(N), b1(N);
-	std::vector<float> r2(N), g2(N), b2(N);
-	#pragma omp parallel for schedule(static)
-	for (int i = 0; i < N; i++) {
-		const Pixel& p1 = data1[i];
-		const Pixel& p2 = data2[i];
-		r1[i] = p1.r; g1[i] = p1.g; b1[i] = p1.b;
-		r2[i] = p2.r; g2[i] = p2.g; b2[i] = p2.b;
+	const std::vector<Channel> channels = channels_for(src.grayscale, options.space);
+	const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+	int levels = 1;
+	while (levels < MS_SSIM_LEVELS && (std::min)(src.width, src.height) >> levels >= 1) {
+		levels++;
 	}
+	context.options = options;
+	context.grayscale = src.grayscale;
+	context.channels = static_cast<int>(channels.size());
+	context.levels.resize(levels);
 
-	double ssim_r = calculate_ssim_single_channel(r1.data(), r2.data(), width, height, kernel1d);
-	double ssim_g = calculate_ssim_single_channel(g1.data(), g2.data(), width, height, kernel1d);
-	double ssim_b = calculate_ssim_single_channel(b1.data(), b2.data(), width, height, kernel1d);
+	ReferenceContext::Level& base = context.levels[0];
+	base.width = src.width;
+	base.height = src.height;
+	base.plane.resize(static_cast<size_t>(base.width) * base.height * channels.size());
+	const size_t base_size = static_cast<size_t>(base.width) * base.height;
 
-	return (ssim_r + ssim_g + ssim_b) / 3.0;
+	#pragma omp parallel for schedule(static) num_threads(ThreadBudget::per_job())
+	for (int y = 0; y < src.height; y++) {
+		for (size_t c = 0; c < channels.size(); c++) {
+			load_channel(src.row(y), src.width, channels[c], base.plane.data() + c * base_size + static_cast<size_t>(y) * base.width);
+		}
+	}
+
+	std::vector<float> squared(base_size);
+	std::vector<float> temp(base_size);
+	for (int l = 0; l < levels; l++) {
+		ReferenceContext::Level& level = context.levels[l];
+		if (l > 0) {
+			downsample_level(context.levels[l - 1], level, context.channels);
+		}
+		const size_t size = static_cast<size_t>(level.width) * level.height;
+		level.mean.resize(size * channels.size());
+		level.second_moment.resize(size * channels.size());
+		for (size_t c = 0; c < channels.size(); c++) {
+			const float* plane = level.plane.data() + c * size;
+			for (size_t i = 0; i < size; i++) {
+				squared[i] = plane[i] * plane[i];
+			}
+			convolve_channel(plane, level.mean.data() + c * size, level.width, level.height, kernel1d, temp.data());
+			convolve_channel(squared.data(), level.second_moment.data() + c * size, level.width, level.height, kernel1d, temp.data());
+		}
+	}
+	return context;
+}
+
+double Metrics::calculateMSSSIM(const Image& img1, const Image& img2, const MetricOptions& options) {
+	return calculateMSSSIM(img1.view(), img2.view(), options);
+}
+
+double Metrics::calculateMSSSIM(const ImageView& img1, const ImageView& img2, const MetricOptions& options) {
+	if (img1.width != img2.width || img1.height != img2.height) {
+		std::cerr << "Error: Images must be of the same dimensions for MS-SSIM calculation." << std::endl;
+		return -1.0;
+	}
+	return calculateMSSSIM(buildReference(img1, options), img2);
+}
+
+/**
+ MS-SSIM (Wang, Simoncelli, Bovik 2003): MS-SSIM = SSIM_M^w_M * Π_{j<M} cs_j^w_j, where cs is the
+ contrast-structure term averaged over level j. The reference half of every level comes from
+ the reference context; only μy, E[y²] and E[xy] are filtered here. Negative level terms are
+ clamped to zero before the weighted product, and channels are averaged last.
+*/
+double Metrics::calculateMSSSIM(const ReferenceContext& reference, const ImageView& test) {
+	TRACE_SCOPE("Metrics::ms_ssim");
+	constexpr double WEIGHTS[MS_SSIM_LEVELS] = { 0.0448, 0.2856, 0.3001, 0.2363, 0.1333 };
+	constexpr double C1 = 6.5025;
+	constexpr double C2 = 58.5225;
+
+	if (reference.levels.size() < MS_SSIM_LEVELS) {
+		std::cerr << "Error: Image is too small for " << MS_SSIM_LEVELS << " MS-SSIM levels." << std::endl;
+		return -1.0;
+	}
+	const int border = reference.options.border;
+	if (test.width - 2 * border != reference.levels[0].width || test.height - 2 * border != reference.levels[0].height) {
+		std::cerr << "Error: Images must be of the same dimensions for MS-SSIM calculation." << std::endl;
+		return -1.0;
+	}
+
+	const ReferenceContext distorted = buildReference(test, reference.options);
+	const std::vector<float> kernel1d(std::begin(ConvolutionSIMD::WEIGHTS), std::end(ConvolutionSIMD::WEIGHTS));
+	const size_t base_size = reference.levels[0].plane.size() / reference.channels;
+	std::vector<float> product(base_size);
+	std::vector<float> cross(base_size);
+	std::vector<float> temp(base_size);
+	std::vector<double> row_cs;
+	std::vector<double> row_ssim;
+	std::vector<double> channel_ms(reference.channels, 1.0);
+
+	for (int l = 0; l < MS_SSIM_LEVELS; l++) {
+		const ReferenceContext::Level& ref = reference.levels[l];
+		const ReferenceContext::Level& dist = distorted.levels[l];
+		const int width = ref.width;
+		const int height = ref.height;
+		const size_t size = static_cast<size_t>(width) * height;
+		const bool last = l == MS_SSIM_LEVELS - 1;
+		row_cs.assign(height, 0.0);
+		row_ssim.assign(height, 0.0);
+
+		for (int c = 0; c < reference.channels; c++) {
+			const size_t offset = static_cast<size_t>(c) * size;
+			for (size_t i = 0; i < size; i++) {
+				product[i] = ref.plane[offset + i] * dist.plane[offset + i];
+			}
+			convolve_channel(product.data(), cross.data(), width, height, kernel1d, temp.data());
+
+			#pragma omp parallel for schedule(static) num_threads(ThreadBudget::per_job())
+			for (int y = 0; y < height; y++) {
+				double cs_sum = 0.0;
+				double ssim_sum = 0.0;
+				for (int x = 0; x < width; x++) {
+					const size_t i = static_cast<size_t>(y) * width + x;
+					double mux = ref.mean[offset + i];
+					double muy = dist.mean[offset + i];
+					double sigmax2 = ref.second_moment[offset + i] - mux * mux;
+					double sigmay2 = dist.second_moment[offset + i] - muy * muy;
+					double sigmaxy = cross[i] - mux * muy;
+
+					double cs = (2 * sigmaxy + C2) / (sigmax2 + sigmay2 + C2);
+					cs_sum += cs;
+					if (last) {
+						ssim_sum += cs * (2 * mux * muy + C1) / (mux * mux + muy * muy + C1);
+					}
+				}
+				row_cs[y] = cs_sum;
+				row_ssim[y] = ssim_sum;
+			}
+
+			const double term = last
+				? std::accumulate(row_ssim.begin(), row_ssim.end(), 0.0) / size
+				: std::accumulate(row_cs.begin(), row_cs.end(), 0.0) / size;
+			channel_ms[c] *= std::pow((std::max)(term, 0.0), WEIGHTS[l]);
+		}
+	}
+
+	return std::accumulate(channel_ms.begin(), channel_ms.end(), 0.0) / reference.channels;
+}
+
+/**
+ Halves a level with a 2x2 box average; an odd last row or column is dropped.
+*/
+void Metrics::downsample_level(const ReferenceContext::Level& src, ReferenceContext::Level& dst, int channels) {
+	dst.width = src.width / 2;
+	dst.height = src.height / 2;
+	const size_t src_size = static_cast<size_t>(src.width) * src.height;
+	const size_t dst_size = static_cast<size_t>(dst.width) * dst.height;
+	dst.plane.resize(dst_size * channels);
+
+	for (int c = 0; c < channels; c++) {
+		const float* in = src.plane.data() + c * src_size;
+		float* out = dst.plane.data() + c * dst_size;
+		#pragma omp parallel for schedule(static) num_threads(ThreadBudget::per_job())
+		for (int y = 0; y < dst.height; y++) {
+			const float* row0 = in + static_cast<size_t>(2 * y) * src.width;
+			const float* row1 = row0 + src.width;
+			float* dst_row = out + static_cast<size_t>(y) * dst.width;
+			for (int x = 0; x < dst.width; x++) {
+				dst_row[x] = 0.25f * (row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1]);
+			}
+		}
+	}
 }
 
 /**
@@ -159,63 +1114,87 @@ void Metrics::convolve_channel(const float* input, float* output, int width, int
 	const float* kern = kernel1d.data();
 
 	// Pass 1: horizontal convolution → temp
-	#pragma omp parallel for schedule(static)
+	#pragma omp parallel for schedule(static) num_threads(ThreadBudget::per_job())
 	for (int y = 0; y < height; y++) {
-		int row = y * width;
+		filter_row_horizontal(input + static_cast<size_t>(y) * width, temp + static_cast<size_t>(y) * width, width, kern, ksize);
+	}
 
-		for (int x = 0; x < half && x < width; x++) {
-			float acc = 0.0f;
+	// Pass 2: vertical convolution → output, border rows are replicated by clamping the taps
+	#pragma omp parallel num_threads(ThreadBudget::per_job())
+	{
+		std::vector<const float*> taps(ksize);
+		#pragma omp for schedule(static)
+		for (int y = 0; y < height; y++) {
 			for (int k = 0; k < ksize; k++) {
-				int ix = x + k - half;
-				if (ix < 0) ix = 0;
-				acc += kern[k] * input[row + ix];
+				int iy = std::clamp(y + k - half, 0, height - 1);
+				taps[k] = temp + static_cast<size_t>(iy) * width;
 			}
-			temp[row + x] = acc;
+			filter_rows_vertical(taps.data(), output + static_cast<size_t>(y) * width, width, kern, ksize);
 		}
+	}
+}
 
-		for (int x = half; x < width - half; x++) {
-			float acc = 0.0f;
-			int base = row + x - half;
-			for (int k = 0; k < ksize; k++) {
-				acc += kern[k] * input[base + k];
-			}
-			temp[row + x] = acc;
+/**
+ One row of the horizontal pass. Edge pixels are replicated; the left and right
+ border loops are separate so the interior loop has no bounds checks.
+ The standard SSIM window runs its interior through the SIMD kernels.
+*/
+void Metrics::filter_row_horizontal(const float* input, float* output, int width, const float* kern, int ksize) {
+	int half = ksize / 2;
+	int left_end = (std::min)(half, width);
+	int right_begin = (std::max)(left_end, width - half);
+
+	for (int x = 0; x < left_end; x++) {
+		float acc = 0.0f;
+		for (int k = 0; k < ksize; k++) {
+			int ix = std::clamp(x + k - half, 0, width - 1);
+			acc += kern[k] * input[ix];
 		}
+		output[x] = acc;
+	}
 
-		for (int x = (std::max)(half, width - half); x < width; x++) {
+	if (ConvolutionSIMD::is_standard_window(kern, ksize)) {
+		ConvolutionSIMD::horizontal(input, output, left_end, right_begin);
+	}
+	else {
+		for (int x = left_end; x < right_begin; x++) {
 			float acc = 0.0f;
+			const float* base = input + x - half;
 			for (int k = 0; k < ksize; k++) {
-				int ix = x + k - half;
-				if (ix >= width) ix = width - 1;
-				acc += kern[k] * input[row + ix];
+				acc += kern[k] * base[k];
 			}
-			temp[row + x] = acc;
+			output[x] = acc;
 		}
 	}
 
-	// Pass 2: vertical convolution → output
-	#pragma omp parallel for schedule(static)
-	for (int y = 0; y < height; y++) {
+	for (int x = right_begin; x < width; x++) {
+		float acc = 0.0f;
+		for (int k = 0; k < ksize; k++) {
+			int ix = std::clamp(x + k - half, 0, width - 1);
+			acc += kern[k] * input[ix];
+		}
+		output[x] = acc;
+	}
+}
+
+/**
+ One row of the vertical pass. rows[k] points at the already clamped source row for tap k,
+ so the inner loop runs along x with unit stride and no branches.
+*/
+void Metrics::filter_rows_vertical(const float* const* rows, float* output, int width, const float* kern, int ksize) {
+	if (ConvolutionSIMD::is_standard_window(kern, ksize)) {
+		ConvolutionSIMD::vertical(rows, output, width);
+		return;
+	}
+
+	for (int x = 0; x < width; x++) {
+		output[x] = 0.0f;
+	}
+	for (int k = 0; k < ksize; k++) {
+		const float* row = rows[k];
+		const float weight = kern[k];
 		for (int x = 0; x < width; x++) {
-			float acc = 0.0f;
-			if (y >= half && y < height - half) {
-				// Interior — no bounds check
-				int base = (y - half) * width + x;
-				for (int k = 0; k < ksize; k++) {
-					acc += kern[k] * temp[base];
-					base += width;
-				}
-			}
-			else {
-				// Border rows
-				for (int k = 0; k < ksize; k++) {
-					int iy = y + k - half;
-					if (iy < 0) iy = 0;
-					else if (iy >= height) iy = height - 1;
-					acc += kern[k] * temp[iy * width + x];
-				}
-			}
-			output[y * width + x] = acc;
+			output[x] += weight * row[x];
 		}
 	}
-}
\ No newline at end of file
+}
@@ -1,16 +1,137 @@
 #pragma once
 #include <algorithm>
 #include "../core/Image.h"
+#include "../core/RowSource.h"
+
+// Mean SSIM per square tile of the compared area, for locating where an upscale fails
+struct SSIMTileMap {
+	int tile_size = 0;
+	int tiles_x = 0;
+	int tiles_y = 0;
+	int origin_x = 0; // image position of tile (0, 0); non-zero when a border was shaved
+	int origin_y = 0;
+	int width = 0;    // compared area in pixels; edge tiles may be smaller than tile_size
+	int height = 0;
+	std::vector<float> ssim; // row-major, averaged over the tile's pixels and channels
+
+	bool empty() const { return ssim.empty(); }
+	float at(int tx, int ty) const { return ssim[static_cast<size_t>(ty) * tiles_x + tx]; }
+};
+
+// Everything Metrics::evaluate gathers in its single pass over an image pair
+struct MetricSet {
+	double psnr = 0.0;
+	double ssim = 0.0;
+	double mse = 0.0;
+	double mae = 0.0;       // mean absolute error per channel sample
+	double max_error = 0.0; // largest absolute channel difference
+	SSIMTileMap tiles;      // filled when MetricOptions::tile_size > 0
+};
+
+enum class ColorSpace {
+	RGB,  // average over the R, G and B channels
+	Luma  // BT.601 Y channel only, as published SR results are measured
+};
+
+struct MetricOptions {
+	ColorSpace space = ColorSpace::RGB;
+	// Pixels shaved from every side before comparing; SR papers use the scale factor
+	int border = 0;
+	// > 0 also collects the SSIM map's per-tile means into MetricSet::tiles
+	int tile_size = 0;
+};
+
+// One image's half of the metric statistics, at every MS-SSIM scale. Building it once for a
+// reference image lets every comparison against that reference skip loading and filtering it.
+struct ReferenceContext {
+	struct Level {
+		int width = 0;
+		int height = 0;
+		std::vector<float> plane;         // channel planes back to back
+		std::vector<float> mean;          // μ
+		std::vector<float> second_moment; // E[x²]
+	};
+
+	MetricOptions options; // space and border every comparison against this context uses
+	bool grayscale = false;
+	int channels = 0;
+	std::vector<Level> levels; // levels[0] is full resolution
+
+	bool empty() const { return levels.empty(); }
+	size_t memory_bytes() const;
+};
 
 class Metrics {
 public:
+	static MetricSet evaluate(const Image& reference, const Image& test, const MetricOptions& options = {});
+	static MetricSet evaluate(const ImageView& reference, const ImageView& test, const MetricOptions& options = {});
+	static MetricSet evaluate(const ReferenceContext& reference, const ImageView& test);
+	// Same result as evaluate() while holding only about band_rows rows of each image
+	static MetricSet evaluateStreaming(IRowSource& reference, IRowSource& test, const MetricOptions& options = {}, int band_rows = 256);
+
 	static double calculatePSNR(const Image& img1, const Image& img2);
 	static double calculateSSIM(const Image& img1, const Image& img2);
+	static double calculatePSNR(const ImageView& img1, const ImageView& img2);
+	static double calculateSSIM(const ImageView& img1, const ImageView& img2);
+	static double calculatePSNR(const ReferenceContext& reference, const ImageView& test);
+	static double calculateSSIM(const ReferenceContext& reference, const ImageView& test);
+
+	static double calculateLumaPSNR(const Image& img1, const Image& img2, int border = 0);
+	static double calculateLumaSSIM(const Image& img1, const Image& img2, int border = 0);
+	static double calculateLumaPSNR(const ImageView& img1, const ImageView& img2, int border = 0);
+	static double calculateLumaSSIM(const ImageView& img1, const ImageView& img2, int border = 0);
+
+	// Uniform-window SSIM from summed-area tables: a screening proxy, not the Gaussian-window SSIM
+	static double calculateFastSSIM(const Image& img1, const Image& img2, const MetricOptions& options = {}, int window = 7);
+	static double calculateFastSSIM(const ImageView& img1, const ImageView& img2, const MetricOptions& options = {}, int window = 7);
+
+	static ReferenceContext buildReference(const ImageView& img, const MetricOptions& options = {});
+	static double calculateMSSSIM(const Image& img1, const Image& img2, const MetricOptions& options = {});
+	static double calculateMSSSIM(const ImageView& img1, const ImageView& img2, const MetricOptions& options = {});
+	static double calculateMSSSIM(const ReferenceContext& reference, const ImageView& test);
+	// The kernel benchmarks time private stages in isolation
+	friend class KernelBenchmarks;
+
 private:
-	static double calculateMSE(const Image& img1, const Image& img2);
+	static constexpr int MS_SSIM_LEVELS = 5;
+
+	enum class Channel { R, G, B, Y };
+
+	struct ErrorSums {
+		double squared = 0.0;
+		double absolute = 0.0;
+		double max_abs = 0.0;
+		void add(const ErrorSums& other);
+	};
+
+	static bool prepare_context_pair(const ReferenceContext& reference, const ImageView& test, const char* what, ImageView& out);
+	static bool prepare_pair(const ImageView& img1, const ImageView& img2, int border, const char* what, ImageView& out1, ImageView& out2);
+	static Channel luma_channel(bool grayscale);
+	static std::vector<Channel> channels_for(bool grayscale, ColorSpace space);
+	// Per-row outputs of ssim_rows for rows [y_begin, y_end); errors and tiles are optional
+	struct RowOutputs {
+		double* ssim = nullptr;      // [(y - y_begin) * channels + c], SSIM summed over the row
+		ErrorSums* errors = nullptr; // [y - y_begin]
+		double* tiles = nullptr;     // [(y - y_begin) * tiles_x + tx], SSIM summed over the tile's columns and all channels
+		int tile_size = 0;
+	};
+
+	static MetricSet make_metric_set(const std::vector<double>& channel_ssim, const ErrorSums& errors, double pixels);
+	static double psnr_from_mse(double mse);
+	static double calculateMSE(const ImageView& img1, const ImageView& img2);
+	static ErrorSums row_errors(const unsigned char* a, const unsigned char* b, int count);
+	static ErrorSums line_errors(const float* a, const float* b, int count);
 	static std::vector<float> create_gaussian_kernel_1d(int size, float sigma);
-	static double calculate_ssim_rgb(const std::vector<Pixel>& data1, const std::vector<Pixel>& data2, int width, int height, const std::vector<float>& kernel1d);
-	static double calculate_ssim_single_channel(const float* ch1, const float* ch2, int width, int height, const std::vector<float>& kernel1d);
+	static void ssim_pass(const ImageView& img1, const ImageView& img2, const std::vector<Channel>& channels, const std::vector<float>& kernel1d, double* channel_ssim, ErrorSums* errors, SSIMTileMap* tiles = nullptr, const ReferenceContext* reference = nullptr);
+	static void ssim_rows(const ImageView& img1, const ImageView& img2, int row_offset, int full_height, int y_begin, int y_end, const std::vector<Channel>& channels, const std::vector<float>& kernel1d, const ReferenceContext* reference, const RowOutputs& out);
+	static void init_tile_map(SSIMTileMap& map, int tile_size, int width, int height, int border);
+	static void add_tile_rows(const SSIMTileMap& map, const double* row_tiles, int y_begin, int y_end, std::vector<double>& tile_sums);
+	static void finish_tile_map(SSIMTileMap& map, const std::vector<double>& tile_sums, int channels);
+	static double box_ssim_channel(const ImageView& img1, const ImageView& img2, Channel channel, int half);
+	static void load_channel(const Pixel* row, int width, Channel channel, float* out);
+	static void downsample_level(const ReferenceContext::Level& src, ReferenceContext::Level& dst, int channels);
 	static void convolve_channel(const float* input, float* output, int width, int height, const std::vector<float>& kernel1d, float* temp_buf);
+	static void filter_row_horizontal(const float* input, float* output, int width, const float* kern, int ksize);
+	static void filter_rows_vertical(const float* const* rows, float* output, int width, const float* kern, int ksize);
 
 };
\ No newline at end of file
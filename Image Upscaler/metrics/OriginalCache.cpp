@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <iostream>
+#include "OriginalCache.h"
+#include "../core/Trace.h"
+
+struct OriginalCache::Entry {
+	struct ContextSlot {
+		std::once_flag built;
+		ReferenceContext context;
+	};
+
+	std::filesystem::path path;
+	std::once_flag decoded;
+	Image image;
+	// Guarded by the cache mutex
+	int pins = 0;
+	size_t bytes = 0;
+	std::list<std::string>::iterator position;
+	// Slots are never erased while the entry lives, so a reference to one stays valid
+	std::mutex contexts_mutex;
+	std::map<std::string, ContextSlot> contexts;
+};
+
+OriginalCache::OriginalCache(size_t budget_bytes) : budget_bytes(budget_bytes) {}
+
+void OriginalCache::add(const std::string& key, const std::filesystem::path& path) {
+	std::lock_guard<std::mutex> lock(mutex);
+	paths[key] = path;
+}
+
+bool OriginalCache::contains(const std::string& key) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return paths.find(key) != paths.end();
+}
+
+size_t OriginalCache::size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return paths.size();
+}
+
+OriginalCacheStats OriginalCache::stats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return counters;
+}
+
+OriginalCache::Pin OriginalCache::acquire(const std::string& key) {
+	std::shared_ptr<Entry> entry;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = resident.find(key);
+		if (found != resident.end()) {
+			entry = found->second;
+			recency.splice(recency.end(), recency, entry->position);
+			counters.hits++;
+		}
+		else {
+			entry = std::make_shared<Entry>();
+			entry->path = paths.at(key);
+			entry->position = recency.insert(recency.end(), key);
+			resident[key] = entry;
+		}
+		entry->pins++;
+	}
+	Pin pin(this, entry);
+
+	// Outside the lock, so other keys are acquired while this one decodes
+	std::call_once(entry->decoded, [&] {
+		TRACE_SCOPE("OriginalCache::load");
+		if (!entry->image.loadFromFile(entry->path.string())) {
+			std::cerr << "Failed to load original: " << entry->path.string() << std::endl;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			counters.loads++;
+		}
+		charge(*entry, entry->image.getData().size() * sizeof(Pixel));
+	});
+	return pin;
+}
+
+void OriginalCache::charge(Entry& entry, size_t bytes) {
+	std::lock_guard<std::mutex> lock(mutex);
+	entry.bytes += bytes;
+	resident_bytes += bytes;
+	counters.peak_bytes = (std::max)(counters.peak_bytes, resident_bytes);
+	evict_unpinned();
+}
+
+void OriginalCache::unpin(Entry& entry) {
+	std::lock_guard<std::mutex> lock(mutex);
+	entry.pins--;
+	evict_unpinned();
+}
+
+// Drops unpinned originals, least recently acquired first, until the resident total fits the budget.
+// Called with the mutex held.
+void OriginalCache::evict_unpinned() {
+	if (budget_bytes == 0) {
+		return;
+	}
+	for (auto it = recency.begin(); it != recency.end() && resident_bytes > budget_bytes;) {
+		auto found = resident.find(*it);
+		if (found->second->pins > 0) {
+			++it;
+			continue;
+		}
+		resident_bytes -= found->second->bytes;
+		resident.erase(found);
+		it = recency.erase(it);
+		counters.evictions++;
+	}
+}
+
+OriginalCache::Pin::Pin(OriginalCache* cache, std::shared_ptr<Entry> entry) : cache(cache), entry(std::move(entry)) {}
+
+OriginalCache::Pin::Pin(Pin&& other) noexcept : cache(other.cache), entry(std::move(other.entry)) {
+	other.cache = nullptr;
+}
+
+OriginalCache::Pin& OriginalCache::Pin::operator=(Pin&& other) noexcept {
+	if (this != &other) {
+		release();
+		cache = other.cache;
+		entry = std::move(other.entry);
+		other.cache = nullptr;
+	}
+	return *this;
+}
+
+OriginalCache::Pin::~Pin() {
+	release();
+}
+
+void OriginalCache::Pin::release() {
+	if (entry) {
+		cache->unpin(*entry);
+		entry.reset();
+	}
+	cache = nullptr;
+}
+
+const Image& OriginalCache::Pin::image() const {
+	return entry->image;
+}
+
+const ReferenceContext& OriginalCache::Pin::reference(const MetricOptions& options) const {
+	const std::string context_key = (options.space == ColorSpace::Luma ? "y@" : "rgb@") + std::to_string(options.border);
+	Entry::ContextSlot* slot;
+	{
+		std::lock_guard<std::mutex> lock(entry->contexts_mutex);
+		slot = &entry->contexts[context_key];
+	}
+	std::call_once(slot->built, [&] {
+		slot->context = Metrics::buildReference(entry->image.view(), options);
+		cache->charge(*entry, slot->context.memory_bytes());
+	});
+	return slot->context;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "../core/Image.h"
+#include "Metrics.h"
+
+struct OriginalCacheStats {
+	size_t loads = 0;      // decodes, reloads after an eviction included
+	size_t hits = 0;       // acquisitions that found the original resident
+	size_t evictions = 0;
+	size_t peak_bytes = 0; // highest resident total, pinned originals included
+};
+
+/**
+ * Originals indexed by key and path, decoded on first use and kept in an LRU within a byte budget.
+ * The budget covers each decoded image and the reference contexts built from it, whose planes and
+ * filtered statistics are several times the size of the image itself.
+ *
+ * acquire() pins an original until its Pin is destroyed; pinned originals are never evicted, so
+ * the resident total can exceed the budget while more originals are in flight than fit, and the
+ * surplus goes as the pins are released. Safe to use from concurrent jobs: jobs acquiring the same
+ * key share one decode, and each context is built by the first job that needs it.
+ */
+class OriginalCache {
+	struct Entry;
+public:
+	// 0 keeps every original once it has been loaded
+	explicit OriginalCache(size_t budget_bytes = 0);
+
+	class Pin {
+	public:
+		Pin() = default;
+		Pin(Pin&& other) noexcept;
+		Pin& operator=(Pin&& other) noexcept;
+		Pin(const Pin&) = delete;
+		Pin& operator=(const Pin&) = delete;
+		~Pin();
+
+		const Image& image() const;
+		// Built on first use for each color space and border
+		const ReferenceContext& reference(const MetricOptions& options) const;
+
+	private:
+		friend class OriginalCache;
+		Pin(OriginalCache* cache, std::shared_ptr<Entry> entry);
+		void release();
+
+		OriginalCache* cache = nullptr;
+		std::shared_ptr<Entry> entry;
+	};
+
+	void add(const std::string& key, const std::filesystem::path& path);
+	bool contains(const std::string& key) const;
+	size_t size() const;
+	// Decodes the original unless it is resident; blocks only on another job decoding the same key
+	Pin acquire(const std::string& key);
+	OriginalCacheStats stats() const;
+	size_t budget() const { return budget_bytes; }
+
+private:
+	void charge(Entry& entry, size_t bytes);
+	void unpin(Entry& entry);
+	void evict_unpinned();
+
+	const size_t budget_bytes;
+	std::map<std::string, std::filesystem::path> paths;
+	std::map<std::string, std::shared_ptr<Entry>> resident;
+	std::list<std::string> recency; // least recently acquired first
+	size_t resident_bytes = 0;
+	OriginalCacheStats counters;
+	mutable std::mutex mutex;
+};
@@ -0,0 +1,59 @@
+#include "TileReport.h"
+#include <algorithm>
+#include <numeric>
+
+std::vector<TileScore> TileReport::worstTiles(const SSIMTileMap& map, int count) {
+	std::vector<size_t> order(map.ssim.size());
+	std::iota(order.begin(), order.end(), 0);
+	count = std::clamp(count, 0, static_cast<int>(order.size()));
+	// Ties keep raster order so reports are stable between runs
+	std::partial_sort(order.begin(), order.begin() + count, order.end(), [&](size_t a, size_t b) {
+		return map.ssim[a] < map.ssim[b] || (map.ssim[a] == map.ssim[b] && a < b);
+	});
+
+	std::vector<TileScore> worst;
+	worst.reserve(count);
+	for (int i = 0; i < count; i++) {
+		const int tx = static_cast<int>(order[i] % map.tiles_x);
+		const int ty = static_cast<int>(order[i] / map.tiles_x);
+		TileScore tile;
+		tile.x = map.origin_x + tx * map.tile_size;
+		tile.y = map.origin_y + ty * map.tile_size;
+		tile.width = (std::min)(map.tile_size, map.width - tx * map.tile_size);
+		tile.height = (std::min)(map.tile_size, map.height - ty * map.tile_size);
+		tile.ssim = map.ssim[order[i]];
+		worst.push_back(tile);
+	}
+	return worst;
+}
+
+/**
+ Renders 1 - SSIM of every tile with a black-red-yellow-white ramp. The scale is fixed by
+ max_loss rather than stretched per image, so heatmaps of different methods compare directly.
+*/
+bool TileReport::writeHeatmap(const SSIMTileMap& map, const std::string& path, int cell_size, float max_loss) {
+	if (map.empty() || cell_size < 1 || max_loss <= 0.0f) {
+		return false;
+	}
+	Image heatmap(map.tiles_x * cell_size, map.tiles_y * cell_size);
+	for (int ty = 0; ty < map.tiles_y; ty++) {
+		for (int tx = 0; tx < map.tiles_x; tx++) {
+			const Pixel color = heat_color((1.0f - map.at(tx, ty)) / max_loss);
+			for (int y = 0; y < cell_size; y++) {
+				for (int x = 0; x < cell_size; x++) {
+					heatmap.at(tx * cell_size + x, ty * cell_size + y) = color;
+				}
+			}
+		}
+	}
+	return heatmap.saveToFile(path);
+}
+
+// t in [0, 1] through black -> red -> yellow -> white
+Pixel TileReport::heat_color(float t) {
+	const float v = std::clamp(t, 0.0f, 1.0f) * 3.0f;
+	auto channel = [](float x) {
+		return static_cast<unsigned char>(std::clamp(x, 0.0f, 1.0f) * 255.0f + 0.5f);
+	};
+	return { channel(v), channel(v - 1.0f), channel(v - 2.0f) };
+}
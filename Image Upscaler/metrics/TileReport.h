@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Metrics.h"
+
+// One tile of an SSIMTileMap, as a pixel rectangle of the full (uncropped) image
+struct TileScore {
+	int x;
+	int y;
+	int width;
+	int height;
+	double ssim;
+};
+
+/**
+ * Presentation of per-tile SSIM: the worst regions of an image and a heatmap of the whole map.
+ */
+class TileReport {
+public:
+	// The count tiles with the lowest SSIM, worst first
+	static std::vector<TileScore> worstTiles(const SSIMTileMap& map, int count);
+	// PNG with one cell_size x cell_size block per tile; black is SSIM 1, white is SSIM <= 1 - max_loss
+	static bool writeHeatmap(const SSIMTileMap& map, const std::string& path, int cell_size = 8, float max_loss = 0.5f);
+private:
+	static Pixel heat_color(float t);
+};
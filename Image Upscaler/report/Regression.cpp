@@ -0,0 +1,248 @@
+#include "Regression.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+
+double Regression::median(std::vector<double> values) {
+	if (values.empty()) {
+		return 0.0;
+	}
+	std::sort(values.begin(), values.end());
+	const size_t mid = values.size() / 2;
+	return values.size() % 2 == 1 ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+/**
+ * U counts the (current, baseline) pairs where the current sample is larger, ties as one half.
+ * Without ties and for small samples the exact null distribution of U is built by the usual
+ * recurrence over arrangements; otherwise the normal approximation with tie and continuity
+ * corrections is used.
+ */
+double Regression::mann_whitney_p(const std::vector<double>& baseline, const std::vector<double>& current) {
+	const int n1 = static_cast<int>(current.size());
+	const int n2 = static_cast<int>(baseline.size());
+	if (n1 < 2 || n2 < 2) {
+		return 1.0;
+	}
+	double u = 0.0;
+	bool ties = false;
+	for (double c : current) {
+		for (double b : baseline) {
+			if (c > b) {
+				u += 1.0;
+			}
+			else if (c == b) {
+				u += 0.5;
+				ties = true;
+			}
+		}
+	}
+
+	if (!ties && n1 * n2 <= 2500) {
+		// counts[i][j][k]: arrangements of i current and j baseline samples with U == k
+		const int max_u = n1 * n2;
+		std::vector<std::vector<std::vector<double>>> counts(n1 + 1, std::vector<std::vector<double>>(n2 + 1));
+		for (int i = 0; i <= n1; i++) {
+			for (int j = 0; j <= n2; j++) {
+				std::vector<double>& cell = counts[i][j];
+				cell.assign(i * j + 1, 0.0);
+				if (i == 0 || j == 0) {
+					cell[0] = 1.0;
+					continue;
+				}
+				// The largest sample is either a current one (beating all j baseline samples) or a baseline one
+				for (int k = 0; k <= i * j; k++) {
+					double with_current = k >= j && k - j <= (i - 1) * j ? counts[i - 1][j][k - j] : 0.0;
+					double with_baseline = k <= i * (j - 1) ? counts[i][j - 1][k] : 0.0;
+					cell[k] = with_current + with_baseline;
+				}
+			}
+		}
+		const std::vector<double>& distribution = counts[n1][n2];
+		double total = 0.0, tail = 0.0;
+		for (int k = 0; k <= max_u; k++) {
+			total += distribution[k];
+			if (k >= static_cast<int>(u)) {
+				tail += distribution[k];
+			}
+		}
+		return tail / total;
+	}
+
+	std::vector<double> pooled(baseline);
+	pooled.insert(pooled.end(), current.begin(), current.end());
+	std::sort(pooled.begin(), pooled.end());
+	double tie_term = 0.0;
+	for (size_t i = 0; i < pooled.size();) {
+		size_t j = i;
+		while (j < pooled.size() && pooled[j] == pooled[i]) {
+			j++;
+		}
+		const double t = static_cast<double>(j - i);
+		tie_term += t * t * t - t;
+		i = j;
+	}
+	const double n = n1 + n2;
+	const double mean = n1 * n2 / 2.0;
+	const double variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)));
+	if (variance <= 0.0) {
+		return 1.0;
+	}
+	const double z = (u - mean - 0.5) / std::sqrt(variance);
+	return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+double Regression::sign_test_p(int positive, int n) {
+	if (n == 0) {
+		return 1.0;
+	}
+	// Binomial(n, 1/2) upper tail, summed in log space so large batches do not overflow
+	double tail = 0.0;
+	for (int k = positive; k <= n; k++) {
+		tail += std::exp(std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0) - n * std::log(2.0));
+	}
+	return (std::min)(1.0, tail);
+}
+
+std::vector<RegressionFinding> Regression::compareKernels(const std::vector<ResultRecord>& baseline, const std::vector<ResultRecord>& current, const RegressionThresholds& thresholds) {
+	const std::vector<std::string> key_fields = { "kernel", "size" };
+	std::map<std::string, const ResultRecord*> base_by_key;
+	for (const auto& record : baseline) {
+		base_by_key[record.key(key_fields)] = &record;
+	}
+
+	std::vector<RegressionFinding> findings;
+	for (const auto& record : current) {
+		const std::string key = record.key(key_fields);
+		auto found = base_by_key.find(key);
+		if (found == base_by_key.end()) {
+			continue;
+		}
+		const ResultRecord& base = *found->second;
+		const double* base_median = base.find_number("median_ms");
+		const double* current_median = record.find_number("median_ms");
+		if (!base_median || !current_median || *base_median <= 0.0) {
+			continue;
+		}
+
+		RegressionFinding finding;
+		finding.key = key;
+		finding.quantity = "median_ms";
+		finding.baseline = *base_median;
+		finding.current = *current_median;
+		const bool slower = *current_median > *base_median * (1.0 + thresholds.max_slowdown);
+
+		const std::vector<double>* base_samples = base.find_series("samples_ms");
+		const std::vector<double>* current_samples = record.find_series("samples_ms");
+		if (base_samples && current_samples) {
+			finding.p_value = mann_whitney_p(*base_samples, *current_samples);
+			finding.regression = slower && finding.p_value < thresholds.significance;
+		}
+		else {
+			// CSV baselines carry no samples: require the distributions not to overlap at all
+			const double* base_p95 = base.find_number("p95_ms");
+			const double* current_min = record.find_number("min_ms");
+			finding.regression = slower && base_p95 && current_min && *current_min > *base_p95;
+		}
+		findings.push_back(finding);
+	}
+	return findings;
+}
+
+std::vector<RegressionFinding> Regression::compareResults(const std::vector<ResultRecord>& baseline, const std::vector<ResultRecord>& current, const RegressionThresholds& thresholds) {
+	const std::vector<std::string> key_fields = { "method", "scale", "filename" };
+	std::map<std::string, const ResultRecord*> base_by_key;
+	for (const auto& record : baseline) {
+		base_by_key[record.key(key_fields)] = &record;
+	}
+
+	struct TimingGroup {
+		double base_sum = 0.0;
+		double current_sum = 0.0;
+		int slower = 0;
+		int changed = 0;
+	};
+	std::map<std::string, TimingGroup> groups;
+	std::vector<RegressionFinding> findings;
+
+	for (const auto& record : current) {
+		const std::string key = record.key(key_fields);
+		auto found = base_by_key.find(key);
+		if (found == base_by_key.end()) {
+			continue;
+		}
+		const ResultRecord& base = *found->second;
+
+		const struct { const char* name; double max_drop; } qualities[] = {
+			{ "psnr", thresholds.max_psnr_drop_db },
+			{ "ssim", thresholds.max_ssim_drop },
+			{ "ms_ssim", thresholds.max_ssim_drop }
+		};
+		for (const auto& quality : qualities) {
+			const double* before = base.find_number(quality.name);
+			const double* after = record.find_number(quality.name);
+			if (!before || !after) {
+				continue;
+			}
+			RegressionFinding finding;
+			finding.key = key;
+			finding.quantity = quality.name;
+			finding.baseline = *before;
+			finding.current = *after;
+			// Identical images score +inf PSNR on both sides; inf - inf is not a drop
+			finding.regression = *before != *after && *before - *after > quality.max_drop;
+			findings.push_back(finding);
+		}
+
+		const double* before_ms = base.find_number("time_ms");
+		const double* after_ms = record.find_number("time_ms");
+		if (before_ms && after_ms) {
+			TimingGroup& group = groups[record.key({ "method", "scale" })];
+			group.base_sum += *before_ms;
+			group.current_sum += *after_ms;
+			group.slower += *after_ms > *before_ms ? 1 : 0;
+			group.changed += *after_ms != *before_ms ? 1 : 0;
+		}
+	}
+
+	for (const auto& [key, group] : groups) {
+		if (group.base_sum <= 0.0) {
+			continue;
+		}
+		RegressionFinding finding;
+		finding.key = key;
+		finding.quantity = "time_ms (sum)";
+		finding.baseline = group.base_sum;
+		finding.current = group.current_sum;
+		finding.p_value = sign_test_p(group.slower, group.changed);
+		finding.regression = group.current_sum > group.base_sum * (1.0 + thresholds.max_slowdown)
+			&& finding.p_value < thresholds.significance;
+		findings.push_back(finding);
+	}
+	return findings;
+}
+
+int Regression::report(const std::vector<RegressionFinding>& findings, std::ostream& out) {
+	std::ios state(nullptr);
+	state.copyfmt(out);
+	int regressions = 0;
+	for (const auto& finding : findings) {
+		if (!finding.regression) {
+			continue;
+		}
+		regressions++;
+		const double change = finding.baseline != 0.0 ? 100.0 * (finding.current / finding.baseline - 1.0) : 0.0;
+		out << "REGRESSION " << finding.key << " " << finding.quantity << ": "
+			<< std::setprecision(6) << finding.baseline << " -> " << finding.current
+			<< " (" << std::showpos << std::fixed << std::setprecision(2) << change << "%" << std::noshowpos;
+		if (finding.p_value < 1.0) {
+			out << ", p=" << std::setprecision(4) << finding.p_value;
+		}
+		out << ")\n";
+		out.copyfmt(state);
+	}
+	out << "Compared " << findings.size() << " quantities against the baseline, " << regressions << " regressed\n";
+	out.copyfmt(state);
+	return regressions;
+}
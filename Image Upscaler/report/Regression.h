@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ResultRecord.h"
+
+struct RegressionThresholds {
+	// Relative slowdown of the typical time that counts as a regression (0.05 = 5 % slower)
+	double max_slowdown = 0.05;
+	// One-sided significance the slowdown must also reach, so run-to-run noise is not flagged
+	double significance = 0.05;
+	double max_psnr_drop_db = 0.01;
+	double max_ssim_drop = 1e-4;
+};
+
+// One compared quantity of one case
+struct RegressionFinding {
+	std::string key;
+	std::string quantity;
+	double baseline = 0.0;
+	double current = 0.0;
+	double p_value = 1.0; // 1 when the comparison is exact (quality) or has too few samples
+	bool regression = false;
+};
+
+/**
+ * Compares a run against a stored baseline.
+ * Kernel timings: each case's repetitions are compared with a one-sided Mann-Whitney U test;
+ * a case regresses when its median slows by more than max_slowdown and the test is significant.
+ * Driver timings: per (method, scale) group the time_ms of the images present on both sides are
+ * summed (whole milliseconds, so small images often record 0 and have no usable ratio), and a
+ * group regresses when the current sum exceeds the baseline sum by more than max_slowdown and a
+ * sign test over the images whose time changed finds more of them slower than chance allows.
+ * Quality: PSNR, SSIM and MS-SSIM are deterministic, so any drop beyond the threshold is flagged.
+ * Cases missing from either side are skipped.
+ */
+class Regression {
+public:
+	static std::vector<RegressionFinding> compareKernels(const std::vector<ResultRecord>& baseline, const std::vector<ResultRecord>& current, const RegressionThresholds& thresholds);
+	static std::vector<RegressionFinding> compareResults(const std::vector<ResultRecord>& baseline, const std::vector<ResultRecord>& current, const RegressionThresholds& thresholds);
+	// Prints every finding, regressions marked; returns the number of regressions
+	static int report(const std::vector<RegressionFinding>& findings, std::ostream& out);
+
+private:
+	// P(X >= Y) one-sided p-value that current samples are stochastically larger than baseline ones
+	static double mann_whitney_p(const std::vector<double>& baseline, const std::vector<double>& current);
+	// P(at least k of n paired differences positive) under the null of equal medians
+	static double sign_test_p(int positive, int n);
+	static double median(std::vector<double> values);
+};
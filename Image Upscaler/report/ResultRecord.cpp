@@ -0,0 +1,509 @@
+#include "ResultRecord.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+const std::string* ResultRecord::find_text(const std::string& key) const {
+	for (const auto& field : text) {
+		if (field.first == key) {
+			return &field.second;
+		}
+	}
+	return nullptr;
+}
+
+const double* ResultRecord::find_number(const std::string& key) const {
+	for (const auto& field : numbers) {
+		if (field.first == key) {
+			return &field.second;
+		}
+	}
+	return nullptr;
+}
+
+const std::vector<double>* ResultRecord::find_series(const std::string& key) const {
+	for (const auto& field : series) {
+		if (field.first == key) {
+			return &field.second;
+		}
+	}
+	return nullptr;
+}
+
+// A CSV cell that looks numeric (a file named "0001") is loaded as a number; it still keys
+std::string ResultRecord::key(const std::vector<std::string>& fields) const {
+	std::string result;
+	for (size_t i = 0; i < fields.size(); i++) {
+		if (i > 0) {
+			result += "|";
+		}
+		if (const std::string* value = find_text(fields[i])) {
+			result += *value;
+		}
+		else if (const double* number = find_number(fields[i])) {
+			std::ostringstream stream;
+			stream << *number;
+			result += stream.str();
+		}
+	}
+	return result;
+}
+
+// JSON has no infinities (PSNR of identical images); they are written as strings
+std::string ResultIO::format_number(double value) {
+	if (std::isnan(value)) {
+		return "\"nan\"";
+	}
+	if (std::isinf(value)) {
+		return value > 0 ? "\"inf\"" : "\"-inf\"";
+	}
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.10g", value);
+	return buffer;
+}
+
+std::string ResultIO::json_escape(const std::string& value) {
+	std::string result = "\"";
+	for (char c : value) {
+		switch (c) {
+		case '"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\t': result += "\\t"; break;
+		case '\r': result += "\\r"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				char buffer[8];
+				std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+				result += buffer;
+			}
+			else {
+				result += c;
+			}
+		}
+	}
+	return result + "\"";
+}
+
+std::string ResultIO::csv_escape(const std::string& value) {
+	if (value.find_first_of(",\"\n") == std::string::npos) {
+		return value;
+	}
+	std::string result = "\"";
+	for (char c : value) {
+		result += c == '"' ? std::string("\"\"") : std::string(1, c);
+	}
+	return result + "\"";
+}
+
+bool ResultIO::writeJson(const std::string& path, const std::string& kind, const std::vector<ResultRecord>& records) {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Error: Cannot write results to " << path << std::endl;
+		return false;
+	}
+	out << "{\n  \"kind\": " << json_escape(kind) << ",\n  \"records\": [";
+	for (size_t r = 0; r < records.size(); r++) {
+		const ResultRecord& record = records[r];
+		out << (r > 0 ? ",\n    {" : "\n    {");
+		bool first = true;
+		auto separator = [&]() {
+			out << (first ? "" : ", ");
+			first = false;
+		};
+		for (const auto& [key, value] : record.text) {
+			separator();
+			out << json_escape(key) << ": " << json_escape(value);
+		}
+		for (const auto& [key, value] : record.numbers) {
+			separator();
+			out << json_escape(key) << ": " << format_number(value);
+		}
+		for (const auto& [key, values] : record.series) {
+			separator();
+			out << json_escape(key) << ": [";
+			for (size_t i = 0; i < values.size(); i++) {
+				out << (i > 0 ? ", " : "") << format_number(values[i]);
+			}
+			out << "]";
+		}
+		out << "}";
+	}
+	out << "\n  ]\n}\n";
+	return static_cast<bool>(out);
+}
+
+bool ResultIO::writeCsv(const std::string& path, const std::vector<ResultRecord>& records) {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Error: Cannot write results to " << path << std::endl;
+		return false;
+	}
+	if (records.empty()) {
+		return true;
+	}
+	// Columns come from the first record; every record of one run has the same fields
+	const ResultRecord& header = records.front();
+	bool first = true;
+	for (const auto& field : header.text) {
+		out << (first ? "" : ",") << csv_escape(field.first);
+		first = false;
+	}
+	for (const auto& field : header.numbers) {
+		out << (first ? "" : ",") << csv_escape(field.first);
+		first = false;
+	}
+	out << "\n";
+	for (const auto& record : records) {
+		first = true;
+		for (const auto& field : header.text) {
+			const std::string* value = record.find_text(field.first);
+			out << (first ? "" : ",") << csv_escape(value ? *value : "");
+			first = false;
+		}
+		for (const auto& field : header.numbers) {
+			const double* value = record.find_number(field.first);
+			out << (first ? "" : ",");
+			if (value) {
+				char buffer[32];
+				std::snprintf(buffer, sizeof(buffer), "%.10g", *value);
+				out << buffer;
+			}
+			first = false;
+		}
+		out << "\n";
+	}
+	return static_cast<bool>(out);
+}
+
+bool ResultIO::load(const std::string& path, std::vector<ResultRecord>& records) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		std::cerr << "Error: Cannot read baseline " << path << std::endl;
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	const std::string content = buffer.str();
+
+	std::string error;
+	const bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+	records.clear();
+	if (!(csv ? load_csv(content, records, error) : load_json(content, records, error))) {
+		std::cerr << "Error: Malformed baseline " << path << ": " << error << std::endl;
+		return false;
+	}
+	return true;
+}
+
+namespace {
+
+// Just enough JSON for result files: objects, arrays, strings, numbers, true/false/null
+class JsonReader {
+public:
+	explicit JsonReader(const std::string& text) : text(text) {}
+
+	std::string error;
+
+	bool expect(char c) {
+		skip_space();
+		if (pos < text.size() && text[pos] == c) {
+			pos++;
+			return true;
+		}
+		return fail(std::string("expected '") + c + "'");
+	}
+
+	bool peek(char c) {
+		skip_space();
+		return pos < text.size() && text[pos] == c;
+	}
+
+	bool read_string(std::string& out) {
+		if (!expect('"')) {
+			return false;
+		}
+		out.clear();
+		while (pos < text.size() && text[pos] != '"') {
+			char c = text[pos++];
+			if (c == '\\' && pos < text.size()) {
+				char e = text[pos++];
+				switch (e) {
+				case 'n': out += '\n'; break;
+				case 't': out += '\t'; break;
+				case 'r': out += '\r'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'u':
+					if (pos + 4 > text.size()) {
+						return fail("truncated escape");
+					}
+					out += static_cast<char>(std::strtol(text.substr(pos, 4).c_str(), nullptr, 16));
+					pos += 4;
+					break;
+				default: out += e;
+				}
+			}
+			else {
+				out += c;
+			}
+		}
+		return expect('"');
+	}
+
+	bool read_number(double& out) {
+		skip_space();
+		const char* begin = text.c_str() + pos;
+		char* end = nullptr;
+		out = std::strtod(begin, &end);
+		if (end == begin) {
+			return fail("expected a value");
+		}
+		pos += end - begin;
+		return true;
+	}
+
+	// Skips any value; used for fields a record cannot hold (nested objects, literals)
+	bool skip_value() {
+		skip_space();
+		if (peek('"')) {
+			std::string ignored;
+			return read_string(ignored);
+		}
+		if (peek('{') || peek('[')) {
+			const char close = text[pos] == '{' ? '}' : ']';
+			pos++;
+			while (!peek(close)) {
+				if (close == '}') {
+					std::string ignored;
+					if (!read_string(ignored) || !expect(':')) {
+						return false;
+					}
+				}
+				if (!skip_value()) {
+					return false;
+				}
+				if (!peek(close) && !expect(',')) {
+					return false;
+				}
+			}
+			return expect(close);
+		}
+		for (const char* literal : { "true", "false", "null" }) {
+			if (text.compare(pos, std::strlen(literal), literal) == 0) {
+				pos += std::strlen(literal);
+				return true;
+			}
+		}
+		double ignored;
+		return read_number(ignored);
+	}
+
+	bool fail(const std::string& message) {
+		if (error.empty()) {
+			error = message + " at offset " + std::to_string(pos);
+		}
+		return false;
+	}
+
+private:
+	const std::string& text;
+	size_t pos = 0;
+
+	void skip_space() {
+		while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+			pos++;
+		}
+	}
+};
+
+double special_number(const std::string& value, bool& matched) {
+	matched = true;
+	if (value == "inf") {
+		return std::numeric_limits<double>::infinity();
+	}
+	if (value == "-inf") {
+		return -std::numeric_limits<double>::infinity();
+	}
+	if (value == "nan") {
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+	matched = false;
+	return 0.0;
+}
+
+bool read_record(JsonReader& reader, ResultRecord& record) {
+	if (!reader.expect('{')) {
+		return false;
+	}
+	while (!reader.peek('}')) {
+		std::string key;
+		if (!reader.read_string(key) || !reader.expect(':')) {
+			return false;
+		}
+		if (reader.peek('"')) {
+			std::string value;
+			if (!reader.read_string(value)) {
+				return false;
+			}
+			bool special;
+			double number = special_number(value, special);
+			if (special) {
+				record.set(key, number);
+			}
+			else {
+				record.set(key, value);
+			}
+		}
+		else if (reader.peek('[')) {
+			reader.expect('[');
+			std::vector<double> values;
+			while (!reader.peek(']')) {
+				double value;
+				if (reader.peek('"')) {
+					std::string special_value;
+					bool special;
+					if (!reader.read_string(special_value)) {
+						return false;
+					}
+					value = special_number(special_value, special);
+				}
+				else if (!reader.read_number(value)) {
+					return false;
+				}
+				values.push_back(value);
+				if (!reader.peek(']') && !reader.expect(',')) {
+					return false;
+				}
+			}
+			reader.expect(']');
+			record.set(key, std::move(values));
+		}
+		else if (reader.peek('{') || reader.peek('t') || reader.peek('f') || reader.peek('n')) {
+			if (!reader.skip_value()) {
+				return false;
+			}
+		}
+		else {
+			double value;
+			if (!reader.read_number(value)) {
+				return false;
+			}
+			record.set(key, value);
+		}
+		if (!reader.peek('}') && !reader.expect(',')) {
+			return false;
+		}
+	}
+	return reader.expect('}');
+}
+
+// Splits one CSV line, honouring quoted cells with doubled quotes
+std::vector<std::string> split_csv_line(const std::string& line) {
+	std::vector<std::string> cells(1);
+	bool quoted = false;
+	for (size_t i = 0; i < line.size(); i++) {
+		char c = line[i];
+		if (quoted) {
+			if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+				cells.back() += '"';
+				i++;
+			}
+			else if (c == '"') {
+				quoted = false;
+			}
+			else {
+				cells.back() += c;
+			}
+		}
+		else if (c == '"') {
+			quoted = true;
+		}
+		else if (c == ',') {
+			cells.emplace_back();
+		}
+		else if (c != '\r') {
+			cells.back() += c;
+		}
+	}
+	return cells;
+}
+
+}
+
+bool ResultIO::load_json(const std::string& content, std::vector<ResultRecord>& records, std::string& error) {
+	JsonReader reader(content);
+	bool ok = reader.expect('{');
+	while (ok && !reader.peek('}')) {
+		std::string key;
+		ok = reader.read_string(key) && reader.expect(':');
+		if (ok && key == "records") {
+			ok = reader.expect('[');
+			while (ok && !reader.peek(']')) {
+				ResultRecord record;
+				ok = read_record(reader, record);
+				records.push_back(std::move(record));
+				if (ok && !reader.peek(']')) {
+					ok = reader.expect(',');
+				}
+			}
+			ok = ok && reader.expect(']');
+		}
+		else if (ok) {
+			ok = reader.skip_value();
+		}
+		if (ok && !reader.peek('}')) {
+			ok = reader.expect(',');
+		}
+	}
+	ok = ok && reader.expect('}');
+	error = reader.error;
+	return ok;
+}
+
+bool ResultIO::load_csv(const std::string& content, std::vector<ResultRecord>& records, std::string& error) {
+	std::istringstream in(content);
+	std::string line;
+	if (!std::getline(in, line)) {
+		error = "missing header row";
+		return false;
+	}
+	const std::vector<std::string> header = split_csv_line(line);
+	int line_number = 1;
+	while (std::getline(in, line)) {
+		line_number++;
+		if (line.empty() || line == "\r") {
+			continue;
+		}
+		std::vector<std::string> cells = split_csv_line(line);
+		if (cells.size() != header.size()) {
+			error = "line " + std::to_string(line_number) + " has " + std::to_string(cells.size())
+				+ " cells, header has " + std::to_string(header.size());
+			return false;
+		}
+		ResultRecord record;
+		for (size_t i = 0; i < cells.size(); i++) {
+			char* end = nullptr;
+			double value = std::strtod(cells[i].c_str(), &end);
+			bool special;
+			double special_value = special_number(cells[i], special);
+			if (special) {
+				record.set(header[i], special_value);
+			}
+			else if (!cells[i].empty() && *end == '\0') {
+				record.set(header[i], value);
+			}
+			else {
+				record.set(header[i], cells[i]);
+			}
+		}
+		records.push_back(std::move(record));
+	}
+	return true;
+}
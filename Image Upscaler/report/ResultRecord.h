@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * One result as a flat set of named fields: the common shape of benchmark-driver results and
+ * kernel timings, so both can be written, reloaded as a baseline and compared the same way.
+ * Fields keep their insertion order, which becomes the CSV column order.
+ */
+struct ResultRecord {
+	std::vector<std::pair<std::string, std::string>> text;
+	std::vector<std::pair<std::string, double>> numbers;
+	// Raw samples (e.g. every timed repetition); JSON only, CSV has no place for them
+	std::vector<std::pair<std::string, std::vector<double>>> series;
+
+	void set(const std::string& key, const std::string& value) { text.emplace_back(key, value); }
+	void set(const std::string& key, double value) { numbers.emplace_back(key, value); }
+	void set(const std::string& key, std::vector<double> values) { series.emplace_back(key, std::move(values)); }
+
+	const std::string* find_text(const std::string& key) const;
+	const double* find_number(const std::string& key) const;
+	const std::vector<double>* find_series(const std::string& key) const;
+	// Text fields joined with '|', identifying the same case across runs
+	std::string key(const std::vector<std::string>& fields) const;
+};
+
+/**
+ * JSON and CSV files of result records. JSON is {"kind": ..., "records": [{...}, ...]} with
+ * every field; CSV has a header row and the text and number fields only. load() reads either
+ * format back, picked by extension, and returns false with a message on malformed input.
+ */
+class ResultIO {
+public:
+	static bool writeJson(const std::string& path, const std::string& kind, const std::vector<ResultRecord>& records);
+	static bool writeCsv(const std::string& path, const std::vector<ResultRecord>& records);
+	static bool load(const std::string& path, std::vector<ResultRecord>& records);
+
+private:
+	static bool load_json(const std::string& content, std::vector<ResultRecord>& records, std::string& error);
+	static bool load_csv(const std::string& content, std::vector<ResultRecord>& records, std::string& error);
+	static std::string json_escape(const std::string& value);
+	static std::string csv_escape(const std::string& value);
+	static std::string format_number(double value);
+};
@@ -0,0 +1,38 @@
+#include "OrtRuntime.h"
+#include "../core/ThreadBudget.h"
+
+OrtRuntime::OrtRuntime()
+	: env(make_threading_options(), ORT_LOGGING_LEVEL_WARNING, "SRCNN")
+{
+}
+
+OrtRuntime& OrtRuntime::instance() {
+	static OrtRuntime runtime;
+	return runtime;
+}
+
+/**
+ * The global intra-op pool is sized to the whole budget because concurrent Run() calls share it.
+ * Spinning is disabled: idle ORT workers would otherwise busy-wait on cores that the OpenMP
+ * regions in Metrics need right after inference finishes.
+ */
+Ort::ThreadingOptions OrtRuntime::make_threading_options() {
+	Ort::ThreadingOptions options;
+	options.SetGlobalIntraOpNumThreads(ThreadBudget::total());
+	options.SetGlobalInterOpNumThreads(1);
+	options.SetGlobalSpinControl(0);
+	return options;
+}
+
+Ort::SessionOptions OrtRuntime::make_session_options(int intra_op_threads) const {
+	Ort::SessionOptions opts;
+	if (intra_op_threads > 0) {
+		opts.SetIntraOpNumThreads(intra_op_threads);
+		opts.SetInterOpNumThreads(1);
+		opts.AddConfigEntry("session.intra_op.allow_spinning", "0");
+	}
+	else {
+		opts.DisablePerSessionThreads();
+	}
+	return opts;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <onnxruntime_cxx_api.h>
+
+/**
+ * Process wide ONNX Runtime state. Owns the single Ort::Env with global intra-op and
+ * inter-op thread pools, so every SRCNNUpscaler session schedules onto the same threads
+ * instead of each one spawning hardware_concurrency() workers of its own.
+ */
+class OrtRuntime {
+public:
+	static OrtRuntime& instance();
+
+	Ort::Env& get_env() { return env; }
+	// intra_op_threads > 0 gives the session a private pool of that size instead of the global one
+	Ort::SessionOptions make_session_options(int intra_op_threads = 0) const;
+
+	OrtRuntime(const OrtRuntime&) = delete;
+	OrtRuntime& operator=(const OrtRuntime&) = delete;
+
+private:
+	OrtRuntime();
+
+	Ort::Env env;
+
+	static Ort::ThreadingOptions make_threading_options();
+};
@@ -1,27 +1,130 @@
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
 #include "SRCNNUpscaler.h"
+#include "OrtRuntime.h"
 #include "../core/Scaler.h"
+#include "../core/Statistics.h"
+#include "../core/Trace.h"
 #include "../interpolation/Bicubic.h"
 
-SRCNNUpscaler::SRCNNUpscaler(const std::string& onnx_path)
-	: env(ORT_LOGGING_LEVEL_WARNING, "SRCNN"),
-	session(nullptr)
+SRCNNUpscaler::SRCNNUpscaler(const std::string& onnx_path, const SRCNNOptions& options)
+	: session(nullptr)
 {
 	if (!std::filesystem::exists(onnx_path)) {
 		throw std::runtime_error("ONNX file not found: " + onnx_path);
 	}
 
-	Ort::SessionOptions opts;
-	opts.SetIntraOpNumThreads((std::max)(1u, std::thread::hardware_concurrency()));
+	auto start = std::chrono::steady_clock::now();
+	create_session(onnx_path, options.cache_dir, options.intra_op_threads);
+	auto end = std::chrono::steady_clock::now();
+	load_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	model_name = std::filesystem::path(onnx_path).stem().string();
+	tile_halo = options.tile_halo;
+	adaptive_threshold = options.adaptive_threshold;
+	adaptive_tile = options.adaptive_tile;
+	if (adaptive_tile <= 0) {
+		throw std::runtime_error("Adaptive tile size must be positive");
+	}
+	model_scale = detect_model_scale();
+	init_buckets(options.bucket_sizes);
+}
+
+/**
+ * Without a cache directory the raw ONNX graph is optimized on every construction.
+ * With one, the first construction saves the ORT_ENABLE_ALL result in ORT format and
+ * later constructions load it with the optimizers disabled. The cached graph may contain
+ * hardware specific kernels, so the cache directory is meant to stay local to the machine.
+ */
+void SRCNNUpscaler::create_session(const std::string& onnx_path, const std::string& cache_dir, int intra_op_threads) {
+	OrtRuntime& runtime = OrtRuntime::instance();
+	Ort::Env& env = runtime.get_env();
+
+	if (cache_dir.empty()) {
+		Ort::SessionOptions opts = runtime.make_session_options(intra_op_threads);
+		opts.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
+		session = Ort::Session(env, to_ort_path(onnx_path).c_str(), opts);
+		return;
+	}
+
+	std::string cached_path = cached_model_path(onnx_path, cache_dir);
+	if (std::filesystem::exists(cached_path)) {
+		try {
+			Ort::SessionOptions opts = runtime.make_session_options(intra_op_threads);
+			opts.SetGraphOptimizationLevel(ORT_DISABLE_ALL);
+			opts.AddConfigEntry("session.load_model_format", "ORT");
+			session = Ort::Session(env, to_ort_path(cached_path).c_str(), opts);
+			loaded_from_cache = true;
+			return;
+		}
+		catch (const Ort::Exception& e) {
+			// Truncated or stale entry, rebuild it from the ONNX file below
+			std::cerr << "Discarding ORT cache entry " << cached_path << ": " << e.what() << std::endl;
+			std::error_code ec;
+			std::filesystem::remove(cached_path, ec);
+		}
+	}
+
+	std::filesystem::create_directories(cache_dir);
+
+	// Write under a unique name and rename, so concurrent workers never load a partial file
+	size_t writer_id = std::hash<std::thread::id>{}(std::this_thread::get_id())
+		^ static_cast<size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	std::string temp_path = cached_path + "." + std::to_string(writer_id) + ".tmp";
+
+	Ort::SessionOptions opts = runtime.make_session_options(intra_op_threads);
 	opts.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
+	opts.AddConfigEntry("session.save_model_format", "ORT");
+	opts.SetOptimizedModelFilePath(to_ort_path(temp_path).c_str());
+	session = Ort::Session(env, to_ort_path(onnx_path).c_str(), opts);
 
-	std::wstring wide_path(onnx_path.begin(), onnx_path.end());
-	session = Ort::Session(env, wide_path.c_str(), opts);
+	std::error_code ec;
+	std::filesystem::rename(temp_path, cached_path, ec);
+	if (ec) {
+		std::filesystem::remove(temp_path, ec);
+	}
+}
 
-	model_name = std::filesystem::path(onnx_path).stem().string();
+/**
+ * Cache key is the FNV-1a hash of the ONNX file contents plus the ORT version,
+ * so retrained models and runtime upgrades never pick up a stale graph.
+ */
+std::string SRCNNUpscaler::cached_model_path(const std::string& onnx_path, const std::string& cache_dir) {
+	std::ifstream file(onnx_path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Cannot read ONNX file: " + onnx_path);
+	}
+
+	uint64_t hash = 14695981039346656037ull;
+	std::vector<char> buffer(1 << 16);
+	while (file) {
+		file.read(buffer.data(), buffer.size());
+		std::streamsize count = file.gcount();
+		for (std::streamsize i = 0; i < count; i++) {
+			hash ^= static_cast<unsigned char>(buffer[i]);
+			hash *= 1099511628211ull;
+		}
+	}
+
+	std::ostringstream name;
+	name << std::filesystem::path(onnx_path).stem().string()
+		<< "-" << std::hex << std::setw(16) << std::setfill('0') << hash
+		<< "-ort" << OrtGetApiBase()->GetVersionString() << ".ort";
+	return (std::filesystem::path(cache_dir) / name.str()).string();
+}
+
+std::basic_string<ORTCHAR_T> SRCNNUpscaler::to_ort_path(const std::string& path) {
+	return std::basic_string<ORTCHAR_T>(path.begin(), path.end());
 }
 
 cv::Mat SRCNNUpscaler::inference(const cv::Mat& y_channel) {
+	TRACE_SCOPE("SRCNN::ort_run");
 	const int64_t h = y_channel.rows;
 	const int64_t w = y_channel.cols;
 	std::array<int64_t, 4> input_shape = { 1, 1, h, w };
@@ -56,7 +159,125 @@ cv::Mat SRCNNUpscaler::inference(const cv::Mat& y_channel) {
 	return result;
 }
 
+/**
+ * Allocates the per-bucket tensors and runs every bucket once, so ORT has planned
+ * the memory pattern for each canonical shape before the first real image arrives.
+ */
+void SRCNNUpscaler::init_buckets(std::vector<int> sizes) {
+	std::sort(sizes.begin(), sizes.end());
+	sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+
+	Ort::MemoryInfo mem_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+	for (int size : sizes) {
+		if (size <= 2 * tile_halo) {
+			throw std::runtime_error("Bucket size " + std::to_string(size) + " leaves no room inside the tile halo");
+		}
+
+		auto bucket = std::make_unique<BucketState>();
+		bucket->size = size;
+		bucket->input.assign(static_cast<size_t>(size) * size, 0.0f);
+		const int out_size = size * model_scale;
+		bucket->output.assign(static_cast<size_t>(out_size) * out_size, 0.0f);
+
+		std::array<int64_t, 4> in_shape = { 1, 1, size, size };
+		std::array<int64_t, 4> out_shape = { 1, 1, out_size, out_size };
+		bucket->input_tensor = Ort::Value::CreateTensor<float>(
+			mem_info, bucket->input.data(), bucket->input.size(), in_shape.data(), in_shape.size());
+		bucket->output_tensor = Ort::Value::CreateTensor<float>(
+			mem_info, bucket->output.data(), bucket->output.size(), out_shape.data(), out_shape.size());
+
+		bucket->warmup_ms = run_bucket(*bucket);
+		buckets.push_back(std::move(bucket));
+	}
+}
+
+double SRCNNUpscaler::run_bucket(BucketState& bucket) {
+	TRACE_SCOPE("SRCNN::ort_run_bucket");
+	const char* input_names[] = { "input" };
+	const char* output_names[] = { "output" };
+
+	auto start = std::chrono::steady_clock::now();
+	session.Run(
+		Ort::RunOptions{ nullptr },
+		input_names, &bucket.input_tensor, 1,
+		output_names, &bucket.output_tensor, 1
+	);
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * Images that fit in a bucket are padded up to it and the result is cropped.
+ * Larger images are split over the largest bucket: each tile carries tile_halo pixels
+ * of context on every side and only its interior is written back, so tile seams match
+ * whole-image inference. Borders are replicated rather than zero filled.
+ * Output coordinates are input coordinates times model_scale.
+ */
+cv::Mat SRCNNUpscaler::bucketed_inference(const cv::Mat& y_channel) {
+	const int h = y_channel.rows;
+	const int w = y_channel.cols;
+	const int s = model_scale;
+	cv::Mat result(h * s, w * s, CV_32F);
+
+	for (auto& bucket : buckets) {
+		if (h <= bucket->size && w <= bucket->size) {
+			const int size = bucket->size;
+			std::lock_guard<std::mutex> lock(bucket->mutex);
+			cv::Mat in_view(size, size, CV_32F, bucket->input.data());
+			cv::Mat out_view(size * s, size * s, CV_32F, bucket->output.data());
+			cv::copyMakeBorder(y_channel, in_view, 0, size - h, 0, size - w, cv::BORDER_REPLICATE);
+			bucket->latencies_ms.push_back(run_bucket(*bucket));
+			out_view(cv::Rect(0, 0, w * s, h * s)).copyTo(result);
+			return result;
+		}
+	}
+
+	BucketState& bucket = *buckets.back();
+	const int size = bucket.size;
+	const int core = size - 2 * tile_halo;
+	const int tiles_x = (w + core - 1) / core;
+	const int tiles_y = (h + core - 1) / core;
+
+	cv::Mat padded;
+	cv::copyMakeBorder(y_channel, padded,
+		tile_halo, tile_halo + tiles_y * core - h,
+		tile_halo, tile_halo + tiles_x * core - w,
+		cv::BORDER_REPLICATE);
+
+	std::lock_guard<std::mutex> lock(bucket.mutex);
+	cv::Mat in_view(size, size, CV_32F, bucket.input.data());
+	cv::Mat out_view(size * s, size * s, CV_32F, bucket.output.data());
+	for (int ty = 0; ty < tiles_y; ty++) {
+		for (int tx = 0; tx < tiles_x; tx++) {
+			padded(cv::Rect(tx * core, ty * core, size, size)).copyTo(in_view);
+			bucket.latencies_ms.push_back(run_bucket(bucket));
+
+			int cw = (std::min)(core, w - tx * core);
+			int ch = (std::min)(core, h - ty * core);
+			out_view(cv::Rect(tile_halo * s, tile_halo * s, cw * s, ch * s))
+				.copyTo(result(cv::Rect(tx * core * s, ty * core * s, cw * s, ch * s)));
+		}
+	}
+	return result;
+}
+
+std::vector<BucketLatency> SRCNNUpscaler::get_bucket_latencies() const {
+	std::vector<BucketLatency> report;
+	for (const auto& bucket : buckets) {
+		std::lock_guard<std::mutex> lock(bucket->mutex);
+		report.push_back({
+			bucket->size,
+			bucket->latencies_ms.size(),
+			bucket->warmup_ms,
+			Statistics::percentile(bucket->latencies_ms, 0.50),
+			Statistics::percentile(bucket->latencies_ms, 0.99)
+		});
+	}
+	return report;
+}
+
 cv::Mat SRCNNUpscaler::image_to_mat(const Image& img) {
+	TRACE_SCOPE("SRCNN::aos_to_mat");
 	int w = img.getWidth();
 	int h = img.getHeight();
 	const auto& pixels = img.getData();
@@ -72,6 +293,7 @@ cv::Mat SRCNNUpscaler::image_to_mat(const Image& img) {
 }
 
 Image SRCNNUpscaler::mat_to_image(const cv::Mat& bgr) {
+	TRACE_SCOPE("SRCNN::mat_to_aos");
 	int w = bgr.cols;
 	int h = bgr.rows;
 	Image result(w, h);
@@ -86,39 +308,150 @@ Image SRCNNUpscaler::mat_to_image(const cv::Mat& bgr) {
 	return result;
 }
 
-Image SRCNNUpscaler::upscale(Image& src, int scale_factor) {
-	int target_width = src.getWidth() * scale_factor;
-	int target_height = src.getHeight() * scale_factor;
+/**
+ * Runs one inference on a small probe and compares output to input size.
+ * Pre-upsampling SRCNN models keep the shape, sub-pixel models multiply it by their scale.
+ */
+int SRCNNUpscaler::detect_model_scale() {
+	constexpr int probe_size = 32;
+	cv::Mat probe(probe_size, probe_size, CV_32F, cv::Scalar(0.5));
+	cv::Mat output = inference(probe);
 
-	cv::Mat src_mat = image_to_mat(src);
+	if (output.rows % probe_size != 0 || output.cols != output.rows) {
+		throw std::runtime_error("Unsupported model output shape " + std::to_string(output.rows)
+			+ "x" + std::to_string(output.cols) + " for a " + std::to_string(probe_size) + "px probe");
+	}
+	return output.rows / probe_size;
+}
 
-	cv::Mat upscaled_mat;
-	cv::resize(src_mat, upscaled_mat, cv::Size(target_width, target_height), 0, 0, cv::INTER_CUBIC);
+/**
+ * Splits the network input into adaptive_tile squares and measures the Y variance of each.
+ * Flat tiles keep the bicubic estimate (the input itself for pre-upsampling models, a
+ * bicubic resize of it for sub-pixel models). Textured tiles run through the network
+ * with tile_halo context pixels and only their interior is written back.
+ */
+cv::Mat SRCNNUpscaler::adaptive_inference(const cv::Mat& y_float, const cv::Mat& y_8u, SRCNNRunStats* stats) {
+	const int h = y_float.rows;
+	const int w = y_float.cols;
+	const int s = model_scale;
+	const int tile = adaptive_tile;
 
-	cv::Mat ycrcb;
-	cv::cvtColor(upscaled_mat, ycrcb, cv::COLOR_BGR2YCrCb);
+	cv::Mat result;
+	if (s == 1) {
+		result = y_float.clone();
+	}
+	else {
+		cv::resize(y_float, result, cv::Size(w * s, h * s), 0, 0, cv::INTER_CUBIC);
+	}
+
+	cv::Mat padded;
+	cv::copyMakeBorder(y_float, padded, tile_halo, tile_halo, tile_halo, tile_halo, cv::BORDER_REPLICATE);
 
-	std::vector<cv::Mat> channels;
-	cv::split(ycrcb, channels);
+	const double threshold = adaptive_threshold;
+	int total = 0;
+	int skipped = 0;
+	for (int ty = 0; ty < h; ty += tile) {
+		for (int tx = 0; tx < w; tx += tile) {
+			const int tw = (std::min)(tile, w - tx);
+			const int th = (std::min)(tile, h - ty);
+			total++;
 
-	cv::Mat y_float;
-	channels[0].convertTo(y_float, CV_32F, 1.0 / 255.0);
+			cv::Scalar mean, stddev;
+			cv::meanStdDev(y_8u(cv::Rect(tx, ty, tw, th)), mean, stddev);
+			if (stddev[0] * stddev[0] < threshold) {
+				skipped++;
+				continue;
+			}
+
+			cv::Mat region = padded(cv::Rect(tx, ty, tw + 2 * tile_halo, th + 2 * tile_halo)).clone();
+			cv::Mat out = buckets.empty() ? inference(region) : bucketed_inference(region);
+			out(cv::Rect(tile_halo * s, tile_halo * s, tw * s, th * s))
+				.copyTo(result(cv::Rect(tx * s, ty * s, tw * s, th * s)));
+		}
+	}
+
+	if (stats) {
+		stats->tiles_total += total;
+		stats->tiles_skipped += skipped;
+	}
+	return result;
+}
+
+/**
+ * Classic SRCNN models refine Y at full resolution, so the source is bicubic upscaled to the
+ * target size first. Sub-pixel models see the source itself; their pixel shuffle produces Y at
+ * model_scale and only the chroma planes go through bicubic, in postprocess().
+ */
+SRCNNUpscaler::Planes SRCNNUpscaler::preprocess(const Image& src, cv::Size target_size) const {
+	cv::Mat src_bgr = image_to_mat(src);
+	if (model_scale == 1) {
+		TRACE_SCOPE("SRCNN::cv_resize");
+		cv::Mat upscaled;
+		cv::resize(src_bgr, upscaled, target_size, 0, 0, cv::INTER_CUBIC);
+		src_bgr = upscaled;
+	}
+
+	TRACE_SCOPE("SRCNN::to_ycrcb");
+	Planes planes;
+	cv::Mat ycrcb;
+	cv::cvtColor(src_bgr, ycrcb, cv::COLOR_BGR2YCrCb);
+	cv::split(ycrcb, planes.ycrcb);
+	planes.ycrcb[0].convertTo(planes.y_float, CV_32F, 1.0 / 255.0);
 
 	// Ensure contiguous memory for ONNX Runtime
-	if (!y_float.isContinuous()) {
-		y_float = y_float.clone();
+	if (!planes.y_float.isContinuous()) {
+		planes.y_float = planes.y_float.clone();
 	}
+	return planes;
+}
 
-	cv::Mat sr_y = inference(y_float);
-	(cv::min)((cv::max)(sr_y, 0.0f), 1.0f, sr_y);
+// Network output for the normalized Y plane, model_scale times larger and not yet clamped
+cv::Mat SRCNNUpscaler::super_resolve_y(const Planes& planes, SRCNNRunStats* stats) {
+	TRACE_SCOPE("SRCNN::super_resolve_y");
+	if (adaptive_threshold >= 0.0f) {
+		return adaptive_inference(planes.y_float, planes.ycrcb[0], stats);
+	}
+	return buckets.empty() ? inference(planes.y_float) : bucketed_inference(planes.y_float);
+}
 
-	cv::Mat sr_y_8u;
-	sr_y.convertTo(sr_y_8u, CV_8U, 255.0);
-	channels[0] = sr_y_8u;
+/**
+ * Clamps the network's Y back to 8 bits and merges it with the chroma planes at target_size.
+ * If a sub-pixel model's scale differs from the requested factor, its Y is resized the rest
+ * of the way. planes is left untouched, so the benchmarks can post-process one input repeatedly.
+ */
+Image SRCNNUpscaler::postprocess(const Planes& planes, const cv::Mat& sr_y, cv::Size target_size) const {
+	std::vector<cv::Mat> channels = planes.ycrcb;
+	cv::Mat clamped, y_8u;
+	(cv::min)((cv::max)(sr_y, 0.0f), 1.0f, clamped);
+	clamped.convertTo(y_8u, CV_8U, 255.0);
 
+	if (model_scale > 1) {
+		TRACE_SCOPE("SRCNN::cv_resize");
+		if (y_8u.cols != target_size.width || y_8u.rows != target_size.height) {
+			int interpolation = y_8u.cols > target_size.width ? cv::INTER_AREA : cv::INTER_CUBIC;
+			cv::Mat resized;
+			cv::resize(y_8u, resized, target_size, 0, 0, interpolation);
+			y_8u = resized;
+		}
+		for (int c = 1; c < 3; c++) {
+			cv::Mat resized;
+			cv::resize(planes.ycrcb[c], resized, target_size, 0, 0, cv::INTER_CUBIC);
+			channels[c] = resized;
+		}
+	}
+	channels[0] = y_8u;
+
+	TRACE_SCOPE("SRCNN::merge_to_bgr");
 	cv::Mat merged, result_bgr;
 	cv::merge(channels, merged);
 	cv::cvtColor(merged, result_bgr, cv::COLOR_YCrCb2BGR);
-
 	return mat_to_image(result_bgr);
 }
+
+Image SRCNNUpscaler::upscale(Image& src, int scale_factor, SRCNNRunStats* stats) {
+	TRACE_SCOPE("SRCNN::upscale");
+	cv::Size target_size(src.getWidth() * scale_factor, src.getHeight() * scale_factor);
+	Planes planes = preprocess(src, target_size);
+	cv::Mat sr_y = super_resolve_y(planes, stats);
+	return postprocess(planes, sr_y, target_size);
+}
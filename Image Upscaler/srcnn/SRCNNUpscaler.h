@@ -3,26 +3,104 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <onnxruntime_cxx_api.h>
 #include "../core/Image.h"
 
+struct SRCNNOptions {
+	// Directory for optimized ORT-format graphs. Empty disables the cache.
+	std::string cache_dir;
+	// Square tile sizes the Y plane is padded to before inference, so ORT only ever sees
+	// these shapes and reuses their memory patterns. Empty runs each image at its own shape.
+	std::vector<int> bucket_sizes;
+	// Context pixels around each tile; must cover the network's receptive field radius
+	int tile_halo = 8;
+	// Content-adaptive mode: network input tiles whose Y variance (8-bit units) is below
+	// this keep the bicubic result. Negative runs the network on the whole image.
+	float adaptive_threshold = -1.0f;
+	int adaptive_tile = 128;
+	// > 0 gives the session its own intra-op pool of this many threads instead of the shared
+	// global pool, whose size is fixed when the runtime starts; used by the thread-scaling runs
+	int intra_op_threads = 0;
+};
+
+struct SRCNNRunStats {
+	int tiles_total = 0;
+	int tiles_skipped = 0;
+};
+
+struct BucketLatency {
+	int size;
+	size_t runs;
+	double warmup_ms;
+	double p50_ms;
+	double p99_ms;
+};
+
 class SRCNNUpscaler {
 public:
-	explicit SRCNNUpscaler(const std::string& onnx_path);
+	explicit SRCNNUpscaler(const std::string& onnx_path, const SRCNNOptions& options = {});
 
-	Image upscale(Image& src, int scale_factor);
+	Image upscale(Image& src, int scale_factor, SRCNNRunStats* stats = nullptr);
 
 	const std::string& get_model_name() const { return model_name; }
+	double get_load_time_ms() const { return load_time_ms; }
+	bool is_loaded_from_cache() const { return loaded_from_cache; }
+	// 1 for pre-upsampling models, >1 for sub-pixel models that run on the LR image
+	int get_model_scale() const { return model_scale; }
+	std::vector<BucketLatency> get_bucket_latencies() const;
+
+	// The kernel benchmarks time private stages in isolation
+	friend class KernelBenchmarks;
 
 private:
-	Ort::Env env;
+	// One image on its way into the network: the YCrCb planes at the resolution the network runs
+	// on (the target size for pre-upsampling models, the source size for sub-pixel ones) and the
+	// Y plane normalized to [0, 1]
+	struct Planes {
+		std::vector<cv::Mat> ycrcb;
+		cv::Mat y_float;
+	};
+
+	// Preallocated input/output tensors for one canonical shape
+	struct BucketState {
+		int size = 0;
+		std::vector<float> input;
+		std::vector<float> output;
+		Ort::Value input_tensor{ nullptr };
+		Ort::Value output_tensor{ nullptr };
+		double warmup_ms = 0.0;
+		std::vector<double> latencies_ms;
+		mutable std::mutex mutex;
+	};
+
 	Ort::Session session;
 	Ort::AllocatorWithDefaultOptions allocator;
 	std::string model_name;
+	double load_time_ms = 0.0;
+	bool loaded_from_cache = false;
+	int model_scale = 1;
+	int tile_halo = 8;
+	float adaptive_threshold = -1.0f;
+	int adaptive_tile = 128;
+	std::vector<std::unique_ptr<BucketState>> buckets;
 
 	cv::Mat inference(const cv::Mat& y_channel);
+	cv::Mat adaptive_inference(const cv::Mat& y_float, const cv::Mat& y_8u, SRCNNRunStats* stats);
+	// upscale() is these three stages; the kernel benchmarks time each one
+	Planes preprocess(const Image& src, cv::Size target_size) const;
+	cv::Mat super_resolve_y(const Planes& planes, SRCNNRunStats* stats);
+	Image postprocess(const Planes& planes, const cv::Mat& sr_y, cv::Size target_size) const;
+	int detect_model_scale();
+	cv::Mat bucketed_inference(const cv::Mat& y_channel);
+	void init_buckets(std::vector<int> sizes);
+	double run_bucket(BucketState& bucket);
+
+	void create_session(const std::string& onnx_path, const std::string& cache_dir, int intra_op_threads);
+	static std::string cached_model_path(const std::string& onnx_path, const std::string& cache_dir);
+	static std::basic_string<ORTCHAR_T> to_ort_path(const std::string& path);
 
 	static cv::Mat image_to_mat(const Image& img);
 	static Image mat_to_image(const cv::Mat& bgr);